@@ -0,0 +1,33 @@
+#pragma once
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// キーマップ共通のQMK設定
+//
+// QMK本体(action_tapping.c 等)が見る設定はここに書く
+// keymap.c の中で #define してもキーマップのファイルにしか効かない
+// keymap.c / keymap39_02.c のどちらでビルドしても読まれる
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+// 二役キーのしきい値: 150ms(デフォルト200msより短く、反応良好)
+// keymap.c は学習値の初期値・既定にも使う
+#define TAPPING_TERM 150
+
+// 二役キーを押している間に他のキーを押して離したらホールド
+// (素早い操作でも修飾キーを確実に発動)
+#define PERMISSIVE_HOLD
+
+// しきい値をキーごとに get_tapping_term で返す(keymap.c の適応Tapping Term)
+// keymap39_02.c は get_tapping_term を持たないので全キー TAPPING_TERM
+#define TAPPING_TERM_PER_KEY
+
+// ユーザー設定のEEPROM領域(keymap.c の user_config_t と同じ大きさ)
+#define EECONFIG_USER_DATA_SIZE 32
+
+// 高解像度スクロール(HIDの Resolution Multiplier、keymap.c の高解像度スクロール)
+// keymap39_02.c は解像度を掛けてノッチ単位のまま送る
+#define POINTING_DEVICE_HIRES_SCROLL_ENABLE
+#define POINTING_DEVICE_HIRES_SCROLL_MULTIPLIER 30  // 1ノッチ = 30単位
+
+// 左右間の状態同期(IME・OS等を副側のOLEDに表示、両キーマップの左右同期)
+// トランザクションIDの表はQMK本体が作るので、ここで宣言しないと USER_SYNC_STATE が無い
+#define SPLIT_TRANSACTION_IDS_USER USER_SYNC_STATE
@@ -40,21 +40,44 @@
  * 
  * 【Layer 2の起動】
  * - Space長押し(右手親指) → トラックボール操作しながらクリック、Vim記号
+ * 
+ * 【オートマウス(Layer 3)】
+ * - ボールを動かすと自動で有効、J/K/L 単押しでクリック
+ * 
+ * 【ジェスチャー】
+ * - 左下(Gest)を押しながらボールを弾く → デスクトップ切替・一覧・デスクトップ表示
+ * 
+ * 【キーマップ切替】
+ * - keymap39_02.c の配列も内蔵、設定レイヤーの KMap 長押しで切替(EEPROMに記憶)
  */
 
 // ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
 // Tap-Hold設定
 // 
-// TAPPING_TERM: 150ms(デフォルト200msより短く、反応良好)
-// PERMISSIVE_HOLD: 素早い操作でも修飾キーを確実に発動
+// TAPPING_TERM・PERMISSIVE_HOLD・TAPPING_TERM_PER_KEY は
+// QMK本体から見える必要があるので config.h で定義
+// 二役キーは打鍵から学習した値を使う(適応Tapping Term参照)
 // ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
-#define TAPPING_TERM 150
-#define PERMISSIVE_HOLD
+#define TAPPING_TERM_MIN 110  // 学習値の下限
+#define TAPPING_TERM_MAX 250  // 学習値の上限
+
+// 連続打鍵中(単語の途中)はコンボ・Tap-Holdの判定待ちを省く(連続打鍵検出参照)
+#define STREAK_TERM 150
+
+// コンボはキーマップ側の索引付きエンジンで処理(QMKのコンボは rules.mk で無効)
+#define COMBO_TERM 50
+
+// オートマウス: ボールを動かすと Layer 3 を有効化(オートマウス参照)
+#define AMOUSE_LAYER 3
+#define AMOUSE_THRESHOLD 8   // 有効化に必要な移動量(|x|+|y| の累計)
+#define AMOUSE_TIMEOUT 800   // 最後の操作からこの時間で解除(ms)
+
 #define KEYBALL_SCROLL_DIV_DEFAULT 16
 
 #include QMK_KEYBOARD_H
 #include "quantum.h"
 #include "os_detection.h"
+#include "eeprom.h"
 
 // ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
 // カスタムキーコード(Windows/Mac両対応)
@@ -65,6 +88,13 @@
 // IME_TOGGLE:  かな/英数トグル
 // TAB_CTGUI:   単押し=Tab / 長押し=Ctrl(Win)/Cmd(Mac)
 // SLSH_SCRL:   単押し=/ / 長押し=スクロールモード
+// HOST_SW:     ホストOSの手動切替(自動 → Mac → Win → 自動)
+// STAT_PG:     統計ページ切替(OLED表示 + コンソールへダンプ)
+// ACCEL_SW:    ポインタ加速カーブ切替(なし → 弱 → 強、KBC_SAVEで保存)
+// KINE_SW:     慣性スクロールのオン/オフ(KBC_SAVEで保存)
+// SNAP_AUTO:   スクロールスナップ自動(縦横を動きから判定、KBC_SAVEで保存)
+// GESTURE:     押しながらボールを弾く → デスクトップ切替など(ジェスチャー参照)
+// KEYMAP_SW:   長押しでキーマップ切替(この配列 ⇔ keymap39_02配列、EEPROMに保存)、単押し=ESC
 // ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
 enum custom_keycodes {
     IME_ON = SAFE_RANGE,   // かな/変換(タップ専用)
@@ -73,6 +103,13 @@ enum custom_keycodes {
     IME_TOGGLE,            // かな/英数トグル
     TAB_CTGUI,             // 単押し=Tab / 長押し=Ctrl(Win)/Cmd(Mac)
     SLSH_SCRL,             // 単押し=/ / 長押し=スクロール
+    HOST_SW,               // ホストOS手動切替(OS判定が外れた時用)
+    STAT_PG,               // 統計ページ切替
+    ACCEL_SW,              // ポインタ加速カーブ切替
+    KINE_SW,               // 慣性スクロール切替
+    SNAP_AUTO,             // スクロールスナップ自動
+    GESTURE,               // ジェスチャー(押している間)
+    KEYMAP_SW,             // キーマップ切替
     // JIS/US両対応括弧・記号
     JU_LCBR,               // { (JIS/US両対応)
     JU_RCBR,               // } (JIS/US両対応)
@@ -97,14 +134,158 @@ enum custom_keycodes {
     JU_UNDS,               // _ (JIS/US両対応)
 };
 
+// JIS/US変換テーブルの範囲(JU_* は必ずこの範囲内に追加すること)
+#define JU_FIRST JU_LCBR
+#define JU_LAST  JU_UNDS
+
 // アプリ切替状態保持
 static bool is_app_sw_active = false;
+static uint8_t app_sw_mod;  // 押下中の修飾キー(解放時に同じキーを離す)
 // スクロールモード状態保持
 static bool is_slash_scroll_active = false;
-static uint16_t slash_scroll_timer;
 // Tab/Ctrl(Cmd)状態保持
-static bool is_tab_ctgui_active = false;
-static uint16_t tab_ctgui_timer;
+static uint8_t tab_ctgui_mod;  // 押下中の修飾キー(解放時に同じキーを離す)
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// ホストOSプロファイル
+// 
+// OS判定の結果をここにキャッシュし、キー入力ごとの
+// detected_host_os() 呼び出しをなくす
+// - 更新はOS判定が変化した時(process_detected_host_os_user)のみ
+// - HOST_SW(Layer 2)で手動上書き: 自動 → Mac → Win → 自動
+// - 最後に判定できたOSをEEPROMに記憶し、起動直後の判定が出るまでの間は
+//   それを使う(接続直後の記号・IMEキーから正しい配列で送る)
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+typedef enum {
+    HOST_AUTO,       // OS判定に従う
+    HOST_FORCE_MAC,  // Mac固定
+    HOST_FORCE_WIN,  // Windows固定
+    HOST_OVERRIDE_COUNT,
+} host_override_t;
+
+typedef struct {
+    uint8_t cmd_mod;     // Cmd/Ctrl相当(Mac=Cmd / Win=Ctrl)
+    uint8_t app_sw_mod;  // アプリ切替(Mac=Cmd / Win=Alt)
+    uint8_t ime_on;      // Mac=かな / Win=変換
+    uint8_t ime_off;     // Mac=英数 / Win=無変換
+    bool    is_us;       // 記号をUS配列で送る(Mac) / JIS配列で送る(Win)
+    bool    is_mac;      // ショートカットをMac用で送る(ジェスチャー等)
+} host_profile_t;
+
+static host_profile_t host;
+static os_variant_t host_detected_os = OS_UNSURE;
+static uint8_t host_override = HOST_AUTO;
+
+static void host_profile_refresh(void) {
+    bool is_mac;
+    switch (host_override) {
+        case HOST_FORCE_MAC:
+            is_mac = true;
+            break;
+        case HOST_FORCE_WIN:
+            is_mac = false;
+            break;
+        default:
+            is_mac = host_detected_os == OS_MACOS || host_detected_os == OS_IOS;
+            break;
+    }
+    if (is_mac) {
+        host.cmd_mod    = KC_LGUI;
+        host.app_sw_mod = KC_LGUI;
+        host.ime_on     = KC_LNG1;  // かな
+        host.ime_off    = KC_LNG2;  // 英数
+        host.is_us      = true;
+        host.is_mac     = true;
+    } else {
+        host.cmd_mod    = KC_LCTL;
+        host.app_sw_mod = KC_LALT;
+        host.ime_on     = KC_INT4;  // 変換
+        host.ime_off    = KC_INT5;  // 無変換
+        host.is_us      = false;
+        host.is_mac     = false;
+    }
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// ユーザー設定(EEPROM)
+// 
+// 起動時にRAMへ読み込み、変更があった時だけ書き戻す
+// レイアウトを変えたら USER_CONFIG_VERSION を上げる(初期値で上書きされる)
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+#define USER_CONFIG_VERSION 3
+
+// 学習対象の二役キー(適応Tapping Term参照)
+enum tt_keys {
+    TT_ESC_L1,    // LT(1, KC_ESC)
+    TT_SPC_L2,    // LT(2, KC_SPC)
+    TT_IME_OFF,   // GUI_T(IME_OFF)
+    TT_IME_ON,    // SFT_T(IME_ON)
+    TT_TAB_CTGUI, // TAB_CTGUI
+    TT_KEY_COUNT,
+};
+
+// タップの押下時間の統計(1/16ms単位の指数移動平均)
+typedef struct {
+    uint16_t tap_avg;  // 平均
+    uint16_t tap_dev;  // 平均絶対偏差
+} tt_stats_t;
+
+// EEPROMとは EECONFIG_USER_DATA_SIZE(config.h)単位で読み書きするので raw で大きさを揃える
+typedef union {
+    uint8_t raw[EECONFIG_USER_DATA_SIZE];
+    struct {
+        uint8_t    version;
+        tt_stats_t tt[TT_KEY_COUNT];
+        uint8_t    accel_curve;     // ポインタ加速カーブ(ポインタ加速参照)
+        bool       kinetic_scroll;  // 慣性スクロール(慣性スクロール参照)
+        bool       snap_auto;       // スクロールスナップ自動(自動スクロールスナップ参照)
+        uint8_t    last_host_os;    // 最後に判定できたホストOS(os_variant_t)
+        uint8_t    keymap_profile;  // 使用中のキーマップ(キーマップ切替参照)
+    };
+} user_config_t;
+
+_Static_assert(sizeof(user_config_t) == EECONFIG_USER_DATA_SIZE, "user_config_t does not fit EECONFIG_USER_DATA_SIZE");
+
+static user_config_t user_config;
+static bool          user_config_dirty;  // まだ保存していない変更がある(学習値)
+static uint32_t      user_config_save_time;
+
+static void user_config_save(void) {
+    eeconfig_update_user_datablock(&user_config);
+    user_config_dirty     = false;
+    user_config_save_time = timer_read32();
+}
+
+static void user_config_reset(void) {
+    memset(&user_config, 0, sizeof(user_config));
+    user_config.version = USER_CONFIG_VERSION;
+    for (uint8_t i = 0; i < TT_KEY_COUNT; i++) {
+        // 初期値で TAPPING_TERM になる統計から学習を始める
+        user_config.tt[i].tap_avg = 100 * 16;
+        user_config.tt[i].tap_dev = 10 * 16;
+    }
+}
+
+// EEPROM初期化時にQMKから呼ばれる
+void eeconfig_init_user(void) {
+    user_config_reset();
+    user_config_save();
+}
+
+// OS判定が変化した時だけQMKから呼ばれる
+// 判定できたOSが記憶と違えば保存(ホストを差し替えた時だけ書き込む)
+bool process_detected_host_os_user(os_variant_t detected_os) {
+    if (detected_os == OS_UNSURE) {
+        return true;  // 再接続中など: 記憶しているOSのまま
+    }
+    host_detected_os = detected_os;
+    host_profile_refresh();
+    if (user_config.last_host_os != detected_os) {
+        user_config.last_host_os = detected_os;
+        user_config_save();
+    }
+    return true;
+}
 
 // ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
 // コンボ定義(マウスクリック)
@@ -113,18 +294,45 @@ static uint16_t tab_ctgui_timer;
 // J + K 同時押し → 左クリック
 // K + L 同時押し → 右クリック
 // P + K 同時押し → Backspace
+// 
+// keymap39_02配列では D + F 同時押し → IMEトグル のみ
+// 
+// 2キーのコンボのみ(Layer 0 のキーコードで指定)
+// 判定は下の「コンボエンジン」を参照
 // ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
-const uint16_t PROGMEM combo_ime_toggle[] = {KC_F, KC_G, COMBO_END};
-const uint16_t PROGMEM combo_btn1[] = {KC_J, KC_K, COMBO_END};
-const uint16_t PROGMEM combo_btn2[] = {KC_K, KC_L, COMBO_END};
-const uint16_t PROGMEM combo_bsp[] = {KC_P, KC_K, COMBO_END};
+enum keymap_profiles {
+    KEYMAP_MAIN,     // この配列(Logicool風)
+    KEYMAP_39_02,    // keymap39_02.c の配列
+    KEYMAP_PROFILE_COUNT,
+};
+
+#define KM_MAIN  (1 << KEYMAP_MAIN)
+#define KM_39_02 (1 << KEYMAP_39_02)
 
-combo_t key_combos[] = {
-  COMBO(combo_ime_toggle, IME_TOGGLE),  // F+G = IMEトグル(かな/英数)
-  COMBO(combo_btn1, KC_BTN1),           // J+K = 左クリック
-  COMBO(combo_btn2, KC_BTN2),           // K+L = 右クリック
-  COMBO(combo_bsp, KC_BSPC),            // P+K = Backspace
+typedef struct {
+    uint16_t keys[2];
+    uint16_t action;
+    uint8_t  keymaps;  // 有効なキーマップ(KM_*)
+} user_combo_t;
+
+static const user_combo_t PROGMEM user_combos[] = {
+    {{KC_F, KC_G}, IME_TOGGLE, KM_MAIN},   // F+G = IMEトグル(かな/英数)
+    {{KC_J, KC_K}, KC_BTN1,    KM_MAIN},   // J+K = 左クリック
+    {{KC_K, KC_L}, KC_BTN2,    KM_MAIN},   // K+L = 右クリック
+    {{KC_P, KC_K}, KC_BSPC,    KM_MAIN},   // P+K = Backspace
+    {{KC_D, KC_F}, IME_TOGGLE, KM_39_02},  // D+F = IMEトグル(keymap39_02)
+#ifdef USER_COMBOS_EXTRA
+    USER_COMBOS_EXTRA  // tools/host/combo_bench.c がコンボを増やして計測する
+#endif
 };
+#define USER_COMBO_COUNT (sizeof(user_combos) / sizeof(user_combos[0]))
+
+// コンボ候補のビットマスク(コンボが8個を超えたら uint16_t/uint32_t/uint64_t に広げる)
+#ifndef COMBO_MASK_T
+#    define COMBO_MASK_T uint8_t
+#endif
+typedef COMBO_MASK_T combo_mask_t;
+_Static_assert(USER_COMBO_COUNT <= sizeof(combo_mask_t) * 8, "combo_mask_t is too narrow for user_combos");
 
 // clang-format off
 const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
@@ -146,6 +354,8 @@ const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
   // 
   // 【小指でスクロール】
   // - /キー(SLSH_SCRL): タップ=/ / ホールド=スクロールモード
+  // 
+  // 【左下】Gest: 押しながらボールを弾くとジェスチャー
   // ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
   [0] = LAYOUT_right_ball(
   //┌────────┬────────┬────────┬────────┬────────┐                          ┌────────┬────────┬────────┬────────┬────────┐
@@ -158,8 +368,8 @@ const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
   //│ Z      │ X      │ C      │ V      │ B      │                          │ N      │ M      │ ,      │ .      │ /=SCRL │
     KC_Z     , KC_X     , KC_C     , KC_V     , KC_B     ,                            KC_N     , KC_M     , KC_COMM  , KC_DOT   , SLSH_SCRL,
   //┌────────┬────────┬────────────┬────────────┬────────────┬──────────────┐    ┌──────────────┬──────────┐       ┌────────┐
-  //│ 無効   │ 無効   │ 英数/Cmd  │ Alt        │ ESC/L1     │ Tab/CtrlCmd  │    │ Space/L2     │ かな/Shift│ [🔴]  │ 無効   │
-    XXXXXXX  , XXXXXXX  , GUI_T(IME_OFF), KC_LALT, LT(1,KC_ESC), TAB_CTGUI,        LT(2,KC_SPC), SFT_T(IME_ON),                XXXXXXX
+  //│ 無効   │ Gest   │ 英数/Cmd  │ Alt        │ ESC/L1     │ Tab/CtrlCmd  │    │ Space/L2     │ かな/Shift│ [🔴]  │ 無効   │
+    XXXXXXX  , GESTURE  , GUI_T(IME_OFF), KC_LALT, LT(1,KC_ESC), TAB_CTGUI,        LT(2,KC_SPC), SFT_T(IME_ON),                XXXXXXX
   //└────────┴────────┴────────────┴────────────┴────────────┴──────────────┘    └──────────────┴──────────┘       └────────┘
   ),
 
@@ -171,7 +381,8 @@ const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
   //        * 4 5 6 =
   //        0 1 2 3 %
   // 【右手】括弧類 {} [] + Vim矢印 + ' " 
-  // 【親指】Enter
+  // 【親指】Enter、右端=StatPg(統計ページ切替)
+  // 【左下】Kine: 慣性スクロールのオン/オフ、SnapA: スクロールスナップ自動
   // ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
   [1] = LAYOUT_right_ball(
   //┌────────┬────────┬────────┬────────┬────────┐                          ┌────────┬────────┬────────┬────────┬────────┐
@@ -184,8 +395,8 @@ const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
   //│ 0      │ 1      │ 2      │ 3      │ %      │                          │ (      │ )      │ '      │ "      │ |      │
     KC_0     , KC_1     , KC_2     , KC_3     , KC_PERC  ,                            JU_LPRN  , JU_RPRN  , JU_QUOT  , JU_DQUO  , JU_PIPE  ,
   //┌────────┬────────┬────────┬────────┬────────┬────────┐          ┌──────┬────────┐       ┌────────┐
-  //│ 無効   │ 無効   │ ___    │ ___    │ ___    │ ___    │          │ ___  │ Enter  │ [🔴]  │ 無効   │
-    XXXXXXX  , XXXXXXX  , _______  , _______  , _______  , _______  ,      _______  , KC_ENT   ,                               XXXXXXX
+  //│ Kine   │ SnapA  │ ___    │ ___    │ ___    │ ___    │          │ ___  │ Enter  │ [🔴]  │ StatPg │
+    KINE_SW  , SNAP_AUTO, _______  , _______  , _______  , _______  ,      _______  , KC_ENT   ,                               STAT_PG
   //└────────┴────────┴────────┴────────┴────────┴────────┘          └──────┴────────┘       └────────┘
   ),
   
@@ -205,6 +416,11 @@ const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
   //   # → コメント, Vim単語検索
   //   \ → エスケープ, パス
   // 【左手上段】スクロール設定
+  // 【左下】HostSw: OS判定の手動上書き(自動 → Mac → Win)
+  //         Accel: ポインタ加速カーブ切替(なし → 弱 → 強)
+  //         KMap: 長押しでキーマップ切替(この配列 ⇔ keymap39_02配列)
+  //               ESC/L1の位置なので単押しは ESC
+  // 【右下】Save: CPI・加速カーブなどの設定をEEPROMへ保存
   // 【右手中段】Shift+矢印(選択移動)
   // ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
   [2] = LAYOUT_right_ball(
@@ -218,505 +434,2143 @@ const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
   //│ `      │ #      │ \      │ <      │ >      │                          │ CPI-   │ CPI+   │ PgUp   │ PgDn   │ _      │
     JU_GRV   , KC_HASH  , JU_BSLS  , KC_LABK  , KC_RABK  ,                            CPI_D100 , CPI_I100 , KC_PGUP  , KC_PGDN  , JU_UNDS  ,
   //┌────────┬────────┬────────┬────────┬────────┬────────┐          ┌──────┬────────┐       ┌────────┐
-  //│ 無効   │ 無効   │ ___    │ ___    │ ___    │ ___    │          │ ___  │ SCRL   │ [🔴]  │ 無効   │
-    XXXXXXX  , XXXXXXX  , _______  , _______  , _______  , _______  ,      _______  , SCRL_TO  ,                               XXXXXXX
+  //│ HostSw │ Accel  │ ___    │ ___    │ KMap   │ ___    │          │ ___  │ SCRL   │ [🔴]  │ Save   │
+    HOST_SW  , ACCEL_SW , _______  , _______  , KEYMAP_SW, _______  ,      _______  , SCRL_TO  ,                               KBC_SAVE
+  //└────────┴────────┴────────┴────────┴────────┴────────┘          └──────┴────────┘       └────────┘
+  ),
+
+  // ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+  // Layer 3: オートマウス
+  // 
+  // 【起動】トラックボールを動かすと自動で有効(オートマウス参照)
+  // 【解除】操作が止まって AMOUSE_TIMEOUT 経過 or マウス以外のキー
+  // 【マウスクリック】ホームポジションで単押し(コンボ待ちなし)
+  //   J=左 / K=中 / L=右、H=戻る / ;位置(Enter)=進む
+  // ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+  [AMOUSE_LAYER] = LAYOUT_right_ball(
+  //┌────────┬────────┬────────┬────────┬────────┐                          ┌────────┬────────┬────────┬────────┬────────┐
+  //│ ___    │ ___    │ ___    │ ___    │ ___    │                          │ ___    │ ___    │ ___    │ ___    │ ___    │
+    _______  , _______  , _______  , _______  , _______  ,                            _______  , _______  , _______  , _______  , _______  ,
+  //├────────┼────────┼────────┼────────┼────────┤                          ├────────┼────────┼────────┼────────┼────────┤
+  //│ ___    │ ___    │ ___    │ ___    │ ___    │                          │ 戻る   │ 左     │ 中     │ 右     │ 進む   │
+    _______  , _______  , _______  , _______  , _______  ,                            KC_BTN4  , KC_BTN1  , KC_BTN3  , KC_BTN2  , KC_BTN5  ,
+  //├────────┼────────┼────────┼────────┼────────┤                          ├────────┼────────┼────────┼────────┼────────┤
+  //│ ___    │ ___    │ ___    │ ___    │ ___    │                          │ ___    │ ___    │ ___    │ ___    │ ___    │
+    _______  , _______  , _______  , _______  , _______  ,                            _______  , _______  , _______  , _______  , _______  ,
+  //┌────────┬────────┬────────┬────────┬────────┬────────┐          ┌──────┬────────┐       ┌────────┐
+  //│ ___    │ ___    │ ___    │ ___    │ ___    │ ___    │          │ ___  │ ___    │ [🔴]  │ ___    │
+    _______  , _______  , _______  , _______  , _______  , _______  ,      _______  , _______  ,                               _______
   //└────────┴────────┴────────┴────────┴────────┴────────┘          └──────┴────────┘       └────────┘
   ),
 };
 // clang-format on
 
 // ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
-// カスタムキー処理(Windows/Mac両対応)
+// キーマップ切替(keymap39_02配列を内蔵)
 // 
-// 【IME_ON】単押し=かな/変換(長押しShiftはSFT_Tで処理)
-// 【IME_OFF】単押し=英数/無変換(長押しCmdはGUI_Tで処理)
-// 【APP_SW】アプリ切替(Mac=Cmd+Tab / Win=Alt+Tab)
-// 【IME_TOGGLE】かな/英数トグル
-// 【OS_CTRL_GUI】OSに応じてCtrl/Cmd切替
-// 【SLSH_SCRL】単押し=/ / 長押し=スクロールモード
+// keymap39_02.c の4レイヤーを2つ目の表として持ち、KEYMAP_SW で切り替える
+// - 使用中の表は user_config.keymap_profile に保存(起動時にRAMへ読むだけ)
+// - キーコードの参照先は keymap_active(RAM上のポインタ)、表はPROGMEMのまま
+//   → 打鍵ごとの参照でEEPROMは読まない、切替時だけ書き込む
+// - keymap39_02配列ではオートマウス・レイヤー別ポインタ設定は使わない
+//   (Layer 3 が設定レイヤーなので)
+// - LANG_TOG は IME_TOGGLE に置き換え(ホストOSに合わせて送る)
+// 
+// keymap39_02.c を変えたらこちらも合わせる
 // ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
-// IMEトグル状態保持用
-static bool ime_toggle_state = false; // false: OFF(英数), true: ON(かな)
-
-bool process_record_user(uint16_t keycode, keyrecord_t *record) {
-    switch (keycode) {
-        // かな/変換(タップ専用、ホールドはSFT_Tで処理)
-        case IME_ON:
-            if (record->event.pressed) {
-                switch (detected_host_os()) {
-                    case OS_MACOS:
-                    case OS_IOS:
-                        tap_code(KC_LNG1); // かな
-                        break;
-                    default:
-                        // Windows: 変換キー
-                        tap_code(KC_INT4);
-                        break;
-                }
-            }
-            return false;
+// clang-format off
+static const uint16_t PROGMEM keymaps_39_02[][MATRIX_ROWS][MATRIX_COLS] = {
+  // Layer 0: Base(親指: Cmd / Bsp/L1 Spc/L2 Ctl/L3 / Alt/Sft Tab、;位置=Enter)
+  [0] = LAYOUT_right_ball(
+    KC_Q     , KC_W     , KC_E     , KC_R     , KC_T     ,                            KC_Y     , KC_U     , KC_I     , KC_O     , KC_P     ,
+    KC_A     , KC_S     , KC_D     , KC_F     , KC_G     ,                            KC_H     , KC_J     , KC_K     , KC_L     , KC_ENT   ,
+    KC_Z     , KC_X     , KC_C     , KC_V     , KC_B     ,                            KC_N     , KC_M     , KC_COMM  , KC_DOT   , KC_SLSH  ,
+    XXXXXXX  , XXXXXXX  , KC_LGUI  , LALT_T(KC_LSFT), KC_TAB, LT(1,KC_BSPC), LT(2,KC_SPC), LT(3,KC_LCTL),                   XXXXXXX
+  ),
+  // Layer 1: 記号・ナビゲーション(括弧は右手中段に隣り合わせ)
+  [1] = LAYOUT_right_ball(
+    KC_GRV   , KC_TILD  , KC_QUOT  , KC_DQUO  , KC_ESC   ,                            KC_MINS  , KC_LEFT  , KC_UP    , KC_RGHT  , KC_BSLS  ,
+    KC_PIPE  , KC_PGUP  , KC_PGDN  , XXXXXXX  , XXXXXXX  ,                            KC_LBRC  , KC_RBRC  , KC_LPRN  , KC_RPRN  , KC_LCBR  ,
+    XXXXXXX  , KC_HOME  , KC_END   , XXXXXXX  , XXXXXXX  ,                            KC_UNDS  , KC_COLN  , KC_EQL   , KC_PLUS  , KC_SLSH  ,
+    XXXXXXX  , XXXXXXX  , XXXXXXX  , KC_RCBR  , KC_DEL   , _______  ,      XXXXXXX  , KC_SCLN  ,                               XXXXXXX
+  ),
+  // Layer 2: 数字テンキー(右手)
+  [2] = LAYOUT_right_ball(
+    XXXXXXX  , XXXXXXX  , XXXXXXX  , XXXXXXX  , XXXXXXX  ,                            XXXXXXX  , KC_7     , KC_8     , KC_9     , XXXXXXX  ,
+    XXXXXXX  , XXXXXXX  , XXXXXXX  , XXXXXXX  , XXXXXXX  ,                            XXXXXXX  , KC_4     , KC_5     , KC_6     , KC_ENT   ,
+    XXXXXXX  , XXXXXXX  , XXXXXXX  , XXXXXXX  , XXXXXXX  ,                            XXXXXXX  , KC_1     , KC_2     , KC_3     , XXXXXXX  ,
+    XXXXXXX  , XXXXXXX  , XXXXXXX  , KC_0     , XXXXXXX  , XXXXXXX  ,      _______  , XXXXXXX  ,                               XXXXXXX
+  ),
+  // Layer 3: 設定・ファンクション(左上=KMap: 長押しでキーマップ切替、単押し=ESC)
+  [3] = LAYOUT_right_ball(
+    KEYMAP_SW, XXXXXXX  , XXXXXXX  , XXXXXXX  , KC_F5    ,                            KC_F10   , XXXXXXX  , XXXXXXX  , XXXXXXX  , XXXXXXX  ,
+    KC_EXLM  , KC_AT    , KC_HASH  , KC_DLR   , KC_PERC  ,                            KC_BTN1  , KC_BTN2  , KC_BTN3  , XXXXXXX  , XXXXXXX  ,
+    KC_CIRC  , KC_AMPR  , KC_ASTR  , XXXXXXX  , XXXXXXX  ,                            CPI_D100 , CPI_I100 , SCRL_TO  , SSNP_FRE , KBC_SAVE ,
+    XXXXXXX  , XXXXXXX  , XXXXXXX  , XXXXXXX  , XXXXXXX  , QK_BOOT  ,      KBC_RST  , _______  ,                               XXXXXXX
+  ),
+};
+// clang-format on
 
-        // 英数/無変換(タップ専用、ホールドはGUI_Tで処理)
-        case IME_OFF:
-            if (record->event.pressed) {
-                switch (detected_host_os()) {
-                    case OS_MACOS:
-                    case OS_IOS:
-                        tap_code(KC_LNG2); // 英数
-                        break;
-                    default:
-                        // Windows: 無変換キー
-                        tap_code(KC_INT5);
-                        break;
-                }
-            }
-            return false;
+_Static_assert(sizeof(keymaps_39_02) == sizeof(keymaps), "keymaps_39_02 must have the same number of layers as keymaps");
 
-        // OSでCmd/Ctrl切替(親指キー) - タップ=Tab / ホールド=Ctrl(Win)/Cmd(Mac)
-        case TAB_CTGUI:
-            if (record->event.pressed) {
-                tab_ctgui_timer = timer_read();
-                is_tab_ctgui_active = true;
-                // 長押し開始時点で修飾キーを有効化
-                switch (detected_host_os()) {
-                    case OS_MACOS:
-                    case OS_IOS:
-                        register_code(KC_LGUI); // Cmd
-                        break;
-                    default:
-                        register_code(KC_LCTL); // Ctrl
-                        break;
-                }
-            } else {
-                // キーを離した時
-                switch (detected_host_os()) {
-                    case OS_MACOS:
-                    case OS_IOS:
-                        unregister_code(KC_LGUI);
-                        break;
-                    default:
-                        unregister_code(KC_LCTL);
-                        break;
-                }
-                // タップ判定: Tabキーを送信
-                if (timer_elapsed(tab_ctgui_timer) < TAPPING_TERM) {
-                    tap_code(KC_TAB);
-                }
-                is_tab_ctgui_active = false;
-            }
-            return false;
+static const uint16_t (*keymap_active)[MATRIX_ROWS][MATRIX_COLS] = keymaps;
 
-        // かな/英数トグル
-        case IME_TOGGLE:
-            if (record->event.pressed) {
-                ime_toggle_state = !ime_toggle_state;
-                switch (detected_host_os()) {
-                    case OS_MACOS:
-                    case OS_IOS:
-                        if (ime_toggle_state) {
-                            tap_code(KC_LNG1); // かな
-                        } else {
-                            tap_code(KC_LNG2); // 英数
-                        }
-                        break;
-                    default:
-                        if (ime_toggle_state) {
-                            tap_code(KC_INT4); // 変換
-                        } else {
-                            tap_code(KC_INT5); // 無変換
-                        }
-                        break;
-                }
-            }
-            return false;
+// QMKのキーコード参照を差し替え(VIAの動的キーマップとは併用不可)
+uint16_t keycode_at_keymap_location(uint8_t layer_num, uint8_t row, uint8_t column) {
+    if (layer_num < sizeof(keymaps) / sizeof(keymaps[0]) && row < MATRIX_ROWS && column < MATRIX_COLS) {
+        return pgm_read_word(&keymap_active[layer_num][row][column]);
+    }
+    return KC_TRNS;
+}
 
-        // アプリ切替(Mac=Cmd+Tab / Win=Alt+Tab)
-        case APP_SW:
-            if (record->event.pressed) {
-                if (!is_app_sw_active) {
-                    is_app_sw_active = true;
-                    // OSに応じて修飾キーを切替
-                    switch (detected_host_os()) {
-                        case OS_MACOS:
-                        case OS_IOS:
-                            register_code(KC_LGUI);  // Cmd保持
-                            break;
-                        default:
-                            register_code(KC_LALT);  // Alt保持
-                            break;
-                    }
-                }
-                tap_code(KC_TAB);  // Tab送信
-            }
-            return false;
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// JIS/US変換テーブル
+// 
+// Mac(US配列想定) / Windows(JIS配列想定)で送るキーコード
+// 行の並びは enum の JU_* と同じ(keycode - JU_FIRST で引く)
+// 記号を追加する場合: enum に JU_xxx、ここに1行追加するだけ
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+typedef struct {
+    uint16_t us;   // Mac: US配列
+    uint16_t jis;  // Windows: JIS配列
+} ju_keycodes_t;
 
-        // /キー: タップ=/ / ホールド=スクロールモード
-        case SLSH_SCRL:
-            if (record->event.pressed) {
-                slash_scroll_timer = timer_read();
-                is_slash_scroll_active = true;
-                // 長押し開始時点でスクロールモード有効化
-                keyball_set_scroll_mode(true);
-            } else {
-                // キーを離した時
-                if (timer_elapsed(slash_scroll_timer) < TAPPING_TERM) {
-                    // タップ判定: /キーを送信
-                    tap_code(KC_SLSH);
-                }
-                // スクロールモード無効化(L1が有効ならそちらを優先)
-                is_slash_scroll_active = false;
-                keyball_set_scroll_mode(layer_state_cmp(layer_state, 1));
-            }
-            return false;
+// clang-format off
+static const ju_keycodes_t PROGMEM ju_table[] = {
+    //                        US              JIS
+    [JU_LCBR - JU_FIRST] = { KC_LCBR,       S(KC_RBRC) },  // {  JIS: Shift + ]キー位置
+    [JU_RCBR - JU_FIRST] = { KC_RCBR,       S(KC_BSLS) },  // }  JIS: Shift + \キー位置
+    [JU_LBRC - JU_FIRST] = { KC_LBRC,       KC_RBRC    },  // [  JIS: ]キー位置
+    [JU_RBRC - JU_FIRST] = { KC_RBRC,       KC_BSLS    },  // ]  JIS: \キー位置
+    [JU_PIPE - JU_FIRST] = { KC_PIPE,       S(KC_INT3) },  // |  JIS: Shift + yen key
+    [JU_BSLS - JU_FIRST] = { KC_BSLS,       KC_INT3    },  // \  JIS: yen key (backslash)
+    [JU_TILD - JU_FIRST] = { KC_TILD,       S(KC_EQL)  },  // ~  JIS: Shift + ^キー位置
+    [JU_GRV  - JU_FIRST] = { KC_GRV,        S(KC_LBRC) },  // `  JIS: Shift + @キー位置
+    [JU_AT   - JU_FIRST] = { KC_AT,         KC_LBRC    },  // @  JIS: @キー(Shiftなし)
+    [JU_CIRC - JU_FIRST] = { KC_CIRC,       KC_EQL     },  // ^  JIS: ^キー(Shiftなし)
+    [JU_LPRN - JU_FIRST] = { KC_LPRN,       S(KC_8)    },  // (  JIS: Shift + 8
+    [JU_RPRN - JU_FIRST] = { KC_RPRN,       S(KC_9)    },  // )  JIS: Shift + 9
+    [JU_PLUS - JU_FIRST] = { KC_PLUS,       S(KC_SCLN) },  // +  JIS: Shift + ;
+    [JU_ASTR - JU_FIRST] = { KC_ASTR,       S(KC_QUOT) },  // *  JIS: Shift + :
+    [JU_EQL  - JU_FIRST] = { KC_EQL,        S(KC_MINS) },  // =  JIS: Shift + -
+    [JU_COLN - JU_FIRST] = { KC_COLN,       KC_QUOT    },  // :  JIS: :(Shiftなし)
+    [JU_QUOT - JU_FIRST] = { KC_QUOT,       S(KC_7)    },  // '  JIS: Shift + 7
+    [JU_DQUO - JU_FIRST] = { KC_DQUO,       S(KC_2)    },  // "  JIS: Shift + 2
+    [JU_AMPR - JU_FIRST] = { KC_AMPR,       S(KC_6)    },  // &  JIS: Shift + 6
+    [JU_UNDS - JU_FIRST] = { KC_UNDS,       S(KC_INT1) },  // _  JIS: Shift + ろ
+};
+// clang-format on
 
-        // ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
-        // JIS/US両対応キーコード
-        // Mac(US配列想定) / Windows(JIS配列想定)
-        // ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
-        
-        // { 左波括弧
-        case JU_LCBR:
-            if (record->event.pressed) {
-                switch (detected_host_os()) {
-                    case OS_MACOS:
-                    case OS_IOS:
-                        tap_code16(KC_LCBR);  // US: Shift + [
-                        break;
-                    default:
-                        tap_code16(S(KC_RBRC));  // JIS: Shift + ]キー位置
-                        break;
-                }
-            }
-            return false;
+_Static_assert(sizeof(ju_table) / sizeof(ju_table[0]) == JU_LAST - JU_FIRST + 1, "ju_table must have one row per JU_* keycode");
 
-        // } 右波括弧
-        case JU_RCBR:
-            if (record->event.pressed) {
-                switch (detected_host_os()) {
-                    case OS_MACOS:
-                    case OS_IOS:
-                        tap_code16(KC_RCBR);  // US: Shift + ]
-                        break;
-                    default:
-                        tap_code16(S(KC_BSLS));  // JIS: Shift + \キー位置
-                        break;
-                }
-            }
-            return false;
+// JU_* を現在のホストOS向けキーコードに変換
+static uint16_t ju_translate(uint16_t keycode) {
+    const ju_keycodes_t *row = &ju_table[keycode - JU_FIRST];
+    return pgm_read_word(host.is_us ? &row->us : &row->jis);
+}
 
-        // [ 左角括弧
-        case JU_LBRC:
-            if (record->event.pressed) {
-                switch (detected_host_os()) {
-                    case OS_MACOS:
-                    case OS_IOS:
-                        tap_code(KC_LBRC);  // US: [
-                        break;
-                    default:
-                        tap_code(KC_RBRC);  // JIS: ]キー位置
-                        break;
-                }
-            }
-            return false;
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// 修飾キー付き記号の高速送信
+// 
+// tap_code16(S(kc)) は Shift押下→キー押下→キー解放→Shift解放 の4レポート
+// ここでは修飾を weak mods としてキーと同じレポートに載せ、
+// 押下1レポート + 解放1レポートで送る
+// ユーザーが押している修飾キー(real mods)には触れない
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+static void tap_code16_fast(uint16_t keycode) {
+    uint8_t mods = QK_MODS_GET_MODS(keycode);
+    // 5bit表記(右修飾フラグ付き)を8bitのHID修飾ビットに変換
+    mods = (mods & 0x10) ? (uint8_t)((mods & 0x0F) << 4) : mods;
+    uint8_t code       = QK_MODS_GET_BASIC_KEYCODE(keycode);
+    uint8_t saved_weak = get_weak_mods();
 
-        // ] 右角括弧
-        case JU_RBRC:
-            if (record->event.pressed) {
-                switch (detected_host_os()) {
-                    case OS_MACOS:
-                    case OS_IOS:
-                        tap_code(KC_RBRC);  // US: ]
-                        break;
-                    default:
-                        tap_code(KC_BSLS);  // JIS: \キー位置
-                        break;
-                }
-            }
-            return false;
+    add_weak_mods(mods);
+    register_code(code);  // 修飾 + キーを1レポートで押下
+    wait_ms(TAP_CODE_DELAY);
+    set_weak_mods(saved_weak);
+    unregister_code(code);  // 修飾 + キーを1レポートで解放
+}
 
-        // | パイプ
-        case JU_PIPE:
-            if (record->event.pressed) {
-                switch (detected_host_os()) {
-                    case OS_MACOS:
-                    case OS_IOS:
-                        tap_code16(KC_PIPE);  // US: Shift + backslash
-                        break;
-                    default:
-                        tap_code16(S(KC_INT3));  // JIS: Shift + yen key
-                        break;
-                }
-            }
-            return false;
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// 起動時間の計測・段階的な起動
+// 
+// 電源投入(タイマー0)からの時刻を記録
+// - scan: 最初のマトリクススキャン
+// - key:  最初のキーレポート送信
+// - ptr:  最初のポインタレポート(移動・スクロールあり)
+// キーを押したまま/ボールを転がしながら挿すと、送れるようになった時刻が分かる
+// 
+// OLEDの描画は BOOT_OLED_DELAY 後から始める(USB接続・OS判定の間は
+// メインループをキー処理に回す)。センサーとOLED本体の初期化は
+// keyball/QMK側で行われるのでここでは動かせない
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+#define BOOT_OLED_DELAY 1000  // ms(keyboard_post_init_user から)
 
-        // \ バックスラッシュ
-        case JU_BSLS:
-            if (record->event.pressed) {
-                switch (detected_host_os()) {
-                    case OS_MACOS:
-                    case OS_IOS:
-                        tap_code(KC_BSLS);  // US: backslash
-                        break;
-                    default:
-                        tap_code(KC_INT3);  // JIS: yen key (backslash)
-                        break;
-                }
-            }
-            return false;
+static uint16_t boot_first_scan_ms;  // 0 = まだ
+static uint16_t boot_first_key_ms;
+static uint16_t boot_first_pointer_ms;
+static bool     boot_oled_ready;
 
-        // ~ チルダ
-        case JU_TILD:
-            if (record->event.pressed) {
-                switch (detected_host_os()) {
-                    case OS_MACOS:
-                    case OS_IOS:
-                        tap_code16(KC_TILD);  // US: Shift + `
-                        break;
-                    default:
-                        tap_code16(S(KC_EQL));  // JIS: Shift + ^キー位置
-                        break;
-                }
-            }
-            return false;
+static void boot_mark(uint16_t *ms) {
+    if (*ms == 0) {
+        *ms = MAX(timer_read(), 1);
+    }
+}
 
-        // ` バッククォート
-        case JU_GRV:
-            if (record->event.pressed) {
-                switch (detected_host_os()) {
-                    case OS_MACOS:
-                    case OS_IOS:
-                        tap_code(KC_GRV);  // US: `
-                        break;
-                    default:
-                        tap_code16(S(KC_LBRC));  // JIS: Shift + @キー位置
-                        break;
-                }
-            }
-            return false;
+static uint32_t boot_oled_start(uint32_t trigger_time, void *cb_arg) {
+    boot_oled_ready = true;
+    return 0;
+}
 
-        // @ アットマーク
-        case JU_AT:
-            if (record->event.pressed) {
-                switch (detected_host_os()) {
-                    case OS_MACOS:
-                    case OS_IOS:
-                        tap_code16(KC_AT);  // US: Shift + 2
-                        break;
-                    default:
-                        tap_code(KC_LBRC);  // JIS: @キー(Shiftなし)
-                        break;
-                }
-            }
-            return false;
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// 打鍵遅延ヒストグラム
+// 
+// マトリクスでキーを検出した時刻(record->event.time)から
+// そのキーのHIDレポートを送り終えるまでの時間を記録
+// - Tap-Hold/コンボの判定待ちもここに含まれる
+// - レイヤーを切り替えるだけのキー(MO / LTのホールド)はレポートを送らないので数えない
+// - バケットは2のべき乗: 0, 1, 2-3, 4-7, ... 256ms以上
+//   最後のバケットは上限なし、パーセンタイルは 256 と表示("256+ms" / ">=256ms")
+// - p50/p99 は STAT_PG で OLED に表示、コンソールにもダンプ
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+#define KEYLAT_BUCKETS 10
+#define KEYLAT_OPEN_MS (1u << (KEYLAT_BUCKETS - 2))  // 最後のバケットの下限
 
-        // ^ キャレット
-        case JU_CIRC:
-            if (record->event.pressed) {
-                switch (detected_host_os()) {
-                    case OS_MACOS:
-                    case OS_IOS:
-                        tap_code16(KC_CIRC);  // US: Shift + 6
-                        break;
-                    default:
-                        tap_code(KC_EQL);  // JIS: ^キー(Shiftなし)
-                        break;
-                }
-            }
-            return false;
+static uint16_t keylat_hist[KEYLAT_BUCKETS];
+static uint16_t keylat_count;
 
-        // ( 左丸括弧
-        case JU_LPRN:
-            if (record->event.pressed) {
-                switch (detected_host_os()) {
-                    case OS_MACOS:
-                    case OS_IOS:
-                        tap_code16(KC_LPRN);  // US: Shift + 9
-                        break;
-                    default:
-                        tap_code16(S(KC_8));  // JIS: Shift + 8
-                        break;
-                }
-            }
-            return false;
+static void keylat_record(keyrecord_t *record) {
+    if (!record->event.pressed) {
+        return;
+    }
+    boot_mark(&boot_first_key_ms);
+    uint16_t elapsed = TIMER_DIFF_16(timer_read(), record->event.time);
+    uint8_t  bucket  = 0;
+    while (elapsed && bucket < KEYLAT_BUCKETS - 1) {
+        elapsed >>= 1;
+        bucket++;
+    }
+    // 飽和したら全体を半分にして分布の形を保つ
+    if (keylat_count == UINT16_MAX) {
+        keylat_count = 0;
+        for (uint8_t i = 0; i < KEYLAT_BUCKETS; i++) {
+            keylat_hist[i] >>= 1;
+            keylat_count += keylat_hist[i];
+        }
+    }
+    keylat_hist[bucket]++;
+    keylat_count++;
+}
 
-        // ) 右丸括弧
-        case JU_RPRN:
-            if (record->event.pressed) {
-                switch (detected_host_os()) {
-                    case OS_MACOS:
-                    case OS_IOS:
-                        tap_code16(KC_RPRN);  // US: Shift + 0
-                        break;
-                    default:
-                        tap_code16(S(KC_9));  // JIS: Shift + 9
-                        break;
-                }
-            }
-            return false;
+#if defined(OLED_ENABLE) || defined(CONSOLE_ENABLE)
+// パーセンタイル(バケット上限のms、最後のバケットは KEYLAT_OPEN_MS)を返す
+static uint16_t keylat_percentile(uint8_t pct) {
+    uint32_t target = ((uint32_t)keylat_count * pct + 99) / 100;
+    uint32_t sum    = 0;
+    for (uint8_t i = 0; i < KEYLAT_BUCKETS; i++) {
+        sum += keylat_hist[i];
+        if (sum >= target) {
+            return i < KEYLAT_BUCKETS - 1 ? (1u << i) - 1 : KEYLAT_OPEN_MS;
+        }
+    }
+    return KEYLAT_OPEN_MS;
+}
+#endif
 
-        // + プラス
-        case JU_PLUS:
-            if (record->event.pressed) {
-                switch (detected_host_os()) {
-                    case OS_MACOS:
-                    case OS_IOS:
-                        tap_code16(KC_PLUS);  // US: Shift + =
-                        break;
-                    default:
-                        tap_code16(S(KC_SCLN));  // JIS: Shift + ;
-                        break;
-                }
-            }
-            return false;
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// メインループのプロファイラ
+// 
+// 1秒ごとにマトリクススキャン回数と、メインループの各段の時間を集計
+// 段の区切りはユーザーフックの呼ばれる位置:
+//   SCAN:    ループ先頭 → matrix_scan_user(マトリクス読取 + 左右同期)
+//   RECORD:  process_record_user の中
+//   POINTER: pointing_device_task_user の中
+//   OLED:    oledkit_render_info_user の中(描画のみ、I2C送信は含まない)
+//   SPLIT:   ユーザー状態の左右同期(housekeeping_task_user の中)
+// ループ先頭/末尾は housekeeping_task_user(keyboard_task の直後)
+// 時刻はCPUのカウンタ(AVR: Timer0 4us / RP2040: 1us)、他はms
+// keymap39_02.c の配列も内蔵しているので(キーマップ切替参照)、計測はこちらだけで行う
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+#if defined(__AVR__)
+#    include <util/atomic.h>
+// Timer0(QMKの1msタイマー)のカウンタを下位に足す
+#    define PROF_TICKS_PER_MS (F_CPU / 64 / 1000)
+static uint32_t prof_now(void) {
+    uint32_t ms;
+    uint8_t  sub;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        ms  = timer_read32();
+        sub = TCNT0;
+        if (TIFR0 & _BV(OCF0A)) {  // 1ms割り込みが保留中
+            ms++;
+            sub = TCNT0;
+        }
+    }
+    return ms * PROF_TICKS_PER_MS + sub;
+}
+#elif defined(MCU_RP)
+#    define PROF_TICKS_PER_MS 1000
+#    define prof_now() ((uint32_t)chSysGetRealtimeCounterX())  // 1MHzタイマー
+#else
+#    define PROF_TICKS_PER_MS 1
+#    define prof_now() timer_read32()
+#endif
 
-        // * アスタリスク
-        case JU_ASTR:
-            if (record->event.pressed) {
-                switch (detected_host_os()) {
-                    case OS_MACOS:
-                    case OS_IOS:
-                        tap_code16(KC_ASTR);  // US: Shift + 8
-                        break;
-                    default:
-                        tap_code16(S(KC_QUOT));  // JIS: Shift + :
-                        break;
-                }
-            }
-            return false;
+enum prof_stages {
+    PROF_SCAN,
+    PROF_RECORD,
+    PROF_POINTER,
+    PROF_OLED,
+    PROF_SPLIT,
+    PROF_STAGE_COUNT,
+};
 
-        // = イコール
-        case JU_EQL:
-            if (record->event.pressed) {
-                switch (detected_host_os()) {
-                    case OS_MACOS:
-                    case OS_IOS:
-                        tap_code(KC_EQL);  // US: =
-                        break;
-                    default:
-                        tap_code16(S(KC_MINS));  // JIS: Shift + -
-                        break;
-                }
-            }
-            return false;
+static uint32_t prof_acc[PROF_STAGE_COUNT];  // 集計中(ティック)
+static uint32_t prof_loop_acc;
+static uint16_t prof_scans;
+static uint32_t prof_loop_start;
+static uint32_t prof_window_start;
 
-        // : コロン
-        case JU_COLN:
-            if (record->event.pressed) {
-                switch (detected_host_os()) {
-                    case OS_MACOS:
-                    case OS_IOS:
-                        tap_code16(KC_COLN);  // US: Shift + ;
-                        break;
-                    default:
-                        tap_code(KC_QUOT);  // JIS: : (Shiftなし)
-                        break;
-                }
-            }
-            return false;
+// 直近1秒の結果
+static uint16_t prof_scan_rate;                // スキャン/秒
+static uint16_t prof_loop_us;                  // 1ループ平均(us)
+static uint8_t  prof_share[PROF_STAGE_COUNT];  // ループ時間に対する%
 
-        // ' シングルクォート
-        case JU_QUOT:
-            if (record->event.pressed) {
-                switch (detected_host_os()) {
-                    case OS_MACOS:
-                    case OS_IOS:
-                        tap_code(KC_QUOT);  // US: '
-                        break;
-                    default:
-                        tap_code16(S(KC_7));  // JIS: Shift + 7
-                        break;
-                }
-            }
-            return false;
+static void prof_add(uint8_t stage, uint32_t start) {
+    prof_acc[stage] += prof_now() - start;
+}
 
-        // " ダブルクォート
-        case JU_DQUO:
-            if (record->event.pressed) {
-                switch (detected_host_os()) {
-                    case OS_MACOS:
-                    case OS_IOS:
-                        tap_code16(KC_DQUO);  // US: Shift + '
-                        break;
-                    default:
-                        tap_code16(S(KC_2));  // JIS: Shift + 2
-                        break;
-                }
-            }
-            return false;
+void matrix_scan_user(void) {
+    boot_mark(&boot_first_scan_ms);
+    prof_scans++;
+    prof_add(PROF_SCAN, prof_loop_start);
+}
 
-        // & アンパサンド
-        case JU_AMPR:
-            if (record->event.pressed) {
-                switch (detected_host_os()) {
-                    case OS_MACOS:
-                    case OS_IOS:
-                        tap_code16(KC_AMPR);  // US: Shift + 7
-                        break;
-                    default:
-                        tap_code16(S(KC_6));  // JIS: Shift + 6
-                        break;
-                }
-            }
-            return false;
+static void prof_publish(void) {
+    prof_scan_rate = prof_scans;
+    prof_loop_us   = prof_scans ? prof_loop_acc * 1000 / PROF_TICKS_PER_MS / prof_scans : 0;  // 1秒分なら32bitに収まる
+    for (uint8_t i = 0; i < PROF_STAGE_COUNT; i++) {
+        prof_share[i] = prof_loop_acc ? prof_acc[i] * 100 / prof_loop_acc : 0;
+        prof_acc[i]   = 0;
+    }
+    prof_loop_acc = 0;
+    prof_scans    = 0;
+}
 
-        // _ アンダースコア
-        case JU_UNDS:
-            if (record->event.pressed) {
-                switch (detected_host_os()) {
-                    case OS_MACOS:
-                    case OS_IOS:
-                        tap_code16(KC_UNDS);  // US: Shift + -
-                        break;
-                    default:
-                        tap_code16(S(KC_INT1));  // JIS: Shift + ろ
-                        break;
-                }
-            }
-            return false;
+// ループ末尾(housekeeping_task_user から呼ぶ)
+static void prof_loop_end(void) {
+    prof_loop_acc += prof_now() - prof_loop_start;
+    if (timer_elapsed32(prof_window_start) >= 1000) {
+        prof_window_start = timer_read32();
+        prof_publish();
     }
-    return true;
+    prof_loop_start = prof_now();  // 集計自体の時間は次のループに含めない
 }
 
 // ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
-// レイヤー状態管理
+// 打鍵ヒートマップ(位置別・レイヤー別・同じ手のバイグラム)
 // 
-// - Layer 1でスクロールモードを有効化
-// - Layer 2を離れたらアプリ切替を解放
-// - SLSH_SCRLとの競合を考慮
+// キーマップ(keymap_profile)ごとに集計し、親指配置の比較に使う
+// - RAMには使用中のキーマップの分だけ持つ(切替時に保存して読み直す)
+// - バイグラム: 同じ手で HEAT_BIGRAM_TERM 以内に続いた2打鍵
+//   上位 HEAT_BIGRAMS 個だけ数える(Space-Saving法: 表にない組は
+//   一番少ない枠を置き換え、その回数を引き継ぐ)
+// - どれかが飽和したら全体を半分にして比率を保つ
+// 
+// 【EEPROMへの保存】
+// - HEAT_FLUSH_INTERVAL ごと、HEAT_FLUSH_IDLE 打鍵がない時にまとめて書く
+//   (AVRのEEPROM書き込みは1バイト約3.4msなので打鍵中は書かない)
+// - キーマップごとに HEAT_SLOTS 個の枠を順番に使い、書き込みを分散
+//   起動時は seq が一番新しい正しい枠を読む(書き込み中の電源断でも前の枠が残る)
+// - 変わったバイトだけ書く(eeprom_update_block)
+// - 場所はEEPROMの末尾(VIAの動的キーマップとは併用不可)
+// 
+// STAT_PG の HEAT ページでコンソールへダンプ(1行1項目、"heat " で始まる)
 // ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
-layer_state_t layer_state_set_user(layer_state_t state) {
-    // L2を離れたらアプリ切替を解放
-    if (!layer_state_cmp(state, 2) && is_app_sw_active) {
-        // OSに応じて修飾キーを解放
-        switch (detected_host_os()) {
-            case OS_MACOS:
-            case OS_IOS:
-                unregister_code(KC_LGUI);
-                break;
-            default:
-                unregister_code(KC_LALT);
+#define HEAT_POSITIONS (MATRIX_ROWS * MATRIX_COLS)
+#define HEAT_LAYERS (sizeof(keymaps) / sizeof(keymaps[0]))
+#define HEAT_BIGRAMS 8
+#define HEAT_BIGRAM_TERM 500                    // ms
+#define HEAT_SLOTS 2                            // キーマップごとの枠の数
+#define HEAT_FLUSH_INTERVAL (10 * 60 * 1000UL)  // ms
+#define HEAT_FLUSH_IDLE 3000                    // ms
+#define HEAT_NO_POS 0xFF
+
+_Static_assert(HEAT_POSITIONS < HEAT_NO_POS, "matrix positions must fit in uint8_t");
+
+typedef struct {
+    uint8_t  from;  // 位置(row * MATRIX_COLS + col)
+    uint8_t  to;
+    uint16_t count;
+} heat_bigram_t;
+
+typedef struct {
+    uint16_t      seq;       // 書き込み順(大きい方が新しい、一周しても比較できる)
+    uint8_t       profile;   // keymap_profile
+    uint8_t       checksum;
+    uint16_t      pos[HEAT_POSITIONS];
+    uint16_t      layer[HEAT_LAYERS];
+    heat_bigram_t bigram[HEAT_BIGRAMS];
+} heat_record_t;
+
+#define HEAT_EEPROM_ADDR (TOTAL_EEPROM_BYTE_COUNT - KEYMAP_PROFILE_COUNT * HEAT_SLOTS * sizeof(heat_record_t))
+
+static heat_record_t heat;
+static uint8_t       heat_slot;         // 次に書く枠
+static bool          heat_dirty;
+static uint16_t      heat_events;       // 打鍵ごとに増える(OLEDの更新判定用)
+static uint32_t      heat_flush_time;
+static uint32_t      heat_last_press;
+static uint8_t       heat_prev_pos = HEAT_NO_POS;
+static uint16_t      heat_prev_time;
+
+static void *heat_slot_addr(uint8_t profile, uint8_t slot) {
+    return (void *)(uintptr_t)(HEAT_EEPROM_ADDR + (profile * HEAT_SLOTS + slot) * sizeof(heat_record_t));
+}
+
+static uint8_t heat_checksum(void) {
+    const uint8_t *raw = (const uint8_t *)&heat;
+    uint8_t        sum = 0;
+    for (uint16_t i = 0; i < sizeof(heat); i++) {
+        sum += raw[i];
+    }
+    return ~(uint8_t)(sum - heat.checksum);  // checksum 自身は除く
+}
+
+static bool heat_read_slot(uint8_t profile, uint8_t slot) {
+    eeprom_read_block(&heat, heat_slot_addr(profile, slot), sizeof(heat));
+    return heat.profile == profile && heat.checksum == heat_checksum();
+}
+
+static void heat_load(uint8_t profile) {
+    int8_t   best     = -1;
+    uint16_t best_seq = 0;
+    for (uint8_t slot = 0; slot < HEAT_SLOTS; slot++) {
+        if (heat_read_slot(profile, slot) && (best < 0 || (int16_t)(heat.seq - best_seq) > 0)) {
+            best     = slot;
+            best_seq = heat.seq;
+        }
+    }
+    if (best >= 0) {
+        heat_read_slot(profile, best);
+        heat_slot = (best + 1) % HEAT_SLOTS;
+    } else {
+        memset(&heat, 0, sizeof(heat));
+        heat.profile = profile;
+        heat_slot    = 0;
+    }
+    heat_dirty      = false;
+    heat_prev_pos   = HEAT_NO_POS;
+    heat_flush_time = timer_read32();
+}
+
+static void heat_flush(void) {
+    if (!heat_dirty) {
+        return;
+    }
+    heat.seq++;
+    heat.checksum = heat_checksum();
+    eeprom_update_block(&heat, heat_slot_addr(heat.profile, heat_slot), sizeof(heat));
+    heat_slot       = (heat_slot + 1) % HEAT_SLOTS;
+    heat_dirty      = false;
+    heat_flush_time = timer_read32();
+}
+
+// housekeeping_task_user から呼ぶ
+static void heat_task(void) {
+    if (heat_dirty && timer_elapsed32(heat_flush_time) >= HEAT_FLUSH_INTERVAL && timer_elapsed32(heat_last_press) >= HEAT_FLUSH_IDLE) {
+        heat_flush();
+    }
+}
+
+static void heat_halve(void) {
+    for (uint8_t i = 0; i < HEAT_POSITIONS; i++) {
+        heat.pos[i] >>= 1;
+    }
+    for (uint8_t i = 0; i < HEAT_LAYERS; i++) {
+        heat.layer[i] >>= 1;
+    }
+    for (uint8_t i = 0; i < HEAT_BIGRAMS; i++) {
+        heat.bigram[i].count >>= 1;
+    }
+}
+
+static void heat_bigram_add(uint8_t from, uint8_t to) {
+    uint8_t min = 0;
+    for (uint8_t i = 0; i < HEAT_BIGRAMS; i++) {
+        heat_bigram_t *b = &heat.bigram[i];
+        if (b->count && b->from == from && b->to == to) {
+            if (b->count == UINT16_MAX) {
+                heat_halve();
+            }
+            b->count++;
+            return;
+        }
+        if (b->count < heat.bigram[min].count) {
+            min = i;
+        }
+    }
+    if (heat.bigram[min].count == UINT16_MAX) {
+        heat_halve();
+    }
+    heat.bigram[min].from = from;
+    heat.bigram[min].to   = to;
+    heat.bigram[min].count++;
+}
+
+// 分割キーボードのマトリクスは前半の行が左手
+static bool heat_is_left(uint8_t pos) {
+    return pos / MATRIX_COLS < MATRIX_ROWS / 2;
+}
+
+// 位置とバイグラム: 物理的な打鍵なので pre_process_record_user から呼ぶ
+// (コンボ・Tap-Holdの判定待ちに入る前の打鍵順・時刻で数える)
+static void heat_record_press(keyrecord_t *record) {
+    if (!record->event.pressed || !IS_KEYEVENT(record->event) || record->event.key.row >= MATRIX_ROWS || record->event.key.col >= MATRIX_COLS) {
+        return;
+    }
+    uint8_t pos = record->event.key.row * MATRIX_COLS + record->event.key.col;
+    if (heat.pos[pos] == UINT16_MAX) {
+        heat_halve();
+    }
+    heat.pos[pos]++;
+
+    if (heat_prev_pos != HEAT_NO_POS && TIMER_DIFF_16(record->event.time, heat_prev_time) < HEAT_BIGRAM_TERM && heat_is_left(heat_prev_pos) == heat_is_left(pos)) {
+        heat_bigram_add(heat_prev_pos, pos);
+    }
+    heat_prev_pos  = pos;
+    heat_prev_time = record->event.time;
+
+    heat_dirty      = true;
+    heat_last_press = timer_read32();
+    heat_events++;
+}
+
+// レイヤー: process_record_user から呼ぶ(押下のみ)
+// pre_process の時点ではまだ LT 等のホールドが確定しておらず、
+// LT を押しながら打ったキーが切替前のレイヤーに数えられる
+// この時点では前のキーまでのレイヤー操作が反映済みで、このキー自身の操作はまだ
+static void heat_record_layer(keyrecord_t *record) {
+    uint8_t layer = get_highest_layer(layer_state);
+    if (!record->event.pressed || layer >= HEAT_LAYERS) {
+        return;
+    }
+    if (heat.layer[layer] == UINT16_MAX) {
+        heat_halve();
+    }
+    heat.layer[layer]++;
+}
+
+// リセット・ブートローダーへ入る前にも保存
+bool shutdown_user(bool jump_to_bootloader) {
+    heat_flush();
+    if (user_config_dirty) {
+        user_config_save();
+    }
+    return true;
+}
+
+#if defined(OLED_ENABLE) || defined(CONSOLE_ENABLE)
+static uint32_t heat_total(void) {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < HEAT_LAYERS; i++) {
+        total += heat.layer[i];
+    }
+    return total;
+}
+#endif
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// 統計ページ(STAT_PG)
+// 
+// 押すたびに OLED の表示ページを切替、同じ内容をコンソールに出力
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+enum stat_pages {
+    STAT_PAGE_INFO,     // keyball標準表示
+    STAT_PAGE_LATENCY,  // 打鍵遅延
+    STAT_PAGE_PROFILE,  // スキャン回数・ループ時間
+    STAT_PAGE_BOOT,     // 起動時間
+    STAT_PAGE_HEAT,     // 打鍵ヒートマップ
+    STAT_PAGE_COUNT,
+};
+static uint8_t stat_page = STAT_PAGE_INFO;
+
+static void stat_page_dump(void) {
+#ifdef CONSOLE_ENABLE
+    switch (stat_page) {
+        case STAT_PAGE_LATENCY: {
+            uint16_t p50 = keylat_percentile(50);
+            uint16_t p99 = keylat_percentile(99);
+            uprintf("latency: n=%u p50=%s%ums p99=%s%ums\n", keylat_count, p50 == KEYLAT_OPEN_MS ? ">=" : "", p50, p99 == KEYLAT_OPEN_MS ? ">=" : "", p99);
+            for (uint8_t i = 0; i < KEYLAT_BUCKETS - 1; i++) {
+                uprintf("  <=%4ums: %u\n", (1u << i) - 1, keylat_hist[i]);
+            }
+            uprintf("  >=%4ums: %u\n", KEYLAT_OPEN_MS, keylat_hist[KEYLAT_BUCKETS - 1]);
+            break;
+        }
+        case STAT_PAGE_BOOT:
+            uprintf("boot: scan=%ums key=%ums pointer=%ums\n", boot_first_scan_ms, boot_first_key_ms, boot_first_pointer_ms);
+            break;
+        case STAT_PAGE_PROFILE:
+            uprintf("scan: %u/s loop=%uus\n", prof_scan_rate, prof_loop_us);
+            uprintf("  scan+split=%u%% record=%u%% pointer=%u%% oled=%u%% sync=%u%%\n", prof_share[PROF_SCAN], prof_share[PROF_RECORD], prof_share[PROF_POINTER], prof_share[PROF_OLED], prof_share[PROF_SPLIT]);
+            break;
+        case STAT_PAGE_HEAT:
+            // heat keymap <profile> <total> / heat layer <layer> <n>
+            // heat pos <row> <col> <n> / heat bigram <row> <col> <row> <col> <n>
+            uprintf("heat keymap %u %lu\n", heat.profile, (unsigned long)heat_total());
+            for (uint8_t i = 0; i < HEAT_LAYERS; i++) {
+                uprintf("heat layer %u %u\n", i, heat.layer[i]);
+            }
+            for (uint8_t i = 0; i < HEAT_POSITIONS; i++) {
+                if (heat.pos[i]) {
+                    uprintf("heat pos %u %u %u\n", i / MATRIX_COLS, i % MATRIX_COLS, heat.pos[i]);
+                }
+            }
+            for (uint8_t i = 0; i < HEAT_BIGRAMS; i++) {
+                const heat_bigram_t *b = &heat.bigram[i];
+                if (b->count) {
+                    uprintf("heat bigram %u %u %u %u %u\n", b->from / MATRIX_COLS, b->from % MATRIX_COLS, b->to / MATRIX_COLS, b->to % MATRIX_COLS, b->count);
+                }
+            }
+            break;
+    }
+#endif
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// 連続打鍵(ストリーク)検出
+// 
+// 文字キーが STREAK_TERM 以内の間隔で続いている間は「単語の途中」とみなし
+// - コンボ判定をしない(J/K/L/F/G/P が COMBO_TERM 待たされない)
+// - SLSH_SCRL は押した瞬間にタップ確定
+// - Space(LT(2, KC_SPC))はホールド判定をせず Space を送る(Flow Tap相当)
+//   QMKの FLOW_TAP_TERM は config.h 経由で keymap39_02.c にも効くので使わない
+//   ※ Shift/Cmd系は大文字・ショートカットで使うので対象外
+// 判定は「この打鍵の前まで連続していたか」で行う
+// (コンボの2キー目を連続打鍵と誤判定しないため)
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+static bool     streak_active;      // 今の打鍵はストリーク中
+static bool     streak_run;         // 直前の2打鍵が連続していた
+static bool     streak_prev_alpha;  // 直前の打鍵が文字キー
+static uint16_t streak_last_time;
+
+static bool streak_is_alpha(uint16_t keycode) {
+    return keycode >= KC_A && keycode <= KC_Z;
+}
+
+static void streak_update(uint16_t keycode, keyrecord_t *record) {
+    if (record->event.pressed) {
+        uint16_t interval = TIMER_DIFF_16(record->event.time, streak_last_time);
+        bool     is_alpha = streak_is_alpha(keycode);
+
+        streak_active     = streak_run && interval < STREAK_TERM;
+        streak_run        = is_alpha && streak_prev_alpha && interval < STREAK_TERM;
+        streak_prev_alpha = is_alpha;
+        streak_last_time  = record->event.time;
+    }
+}
+
+static bool     streak_space_held;  // 連続打鍵中に押したSpaceを押下中
+static keypos_t streak_space_key;
+
+// pre_process_record_user から streak_update・combo_process の後に呼ぶ
+// QMKのTap-Hold処理より前なので、false を返せば LT の判定待ちに入らない
+static bool streak_space_process(uint16_t keycode, keyrecord_t *record) {
+    if (record->event.pressed) {
+        if (keycode != LT(2, KC_SPC) || !streak_active) {
+            return true;
+        }
+        streak_space_held = true;
+        streak_space_key  = record->event.key;
+        heat_record_layer(record);  // process_record_user を通らないのでここで数える
+        register_code(KC_SPC);
+        return false;
+    }
+    // 離した時はレイヤーが変わっていても押した位置で判定
+    if (streak_space_held && record->event.key.row == streak_space_key.row && record->event.key.col == streak_space_key.col) {
+        streak_space_held = false;
+        unregister_code(KC_SPC);
+        return false;
+    }
+    return true;
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// ポインタ加速
+// 
+// 1レポートの移動量(|x|+|y|)で倍率表を引き、x/y に掛ける
+// - 倍率は 1/256 単位の固定小数点(256 = 等倍)、浮動小数点なし
+// - 遅い時は等倍未満(細かい操作)、速い時は等倍超(画面の端まで一気に)
+// - 掛けた結果の端数は次のレポートに持ち越す(遅い動きが消えない)
+// - ACCEL_SW で切替、KBC_SAVE で CPI と一緒に EEPROM へ保存
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+enum accel_curves {
+    ACCEL_OFF,     // 等倍(CPIのみ)
+    ACCEL_MILD,    // 弱: 0.63倍 → 1.75倍
+    ACCEL_STRONG,  // 強: 0.5倍 → 3倍
+    ACCEL_CURVE_COUNT,
+};
+
+#define ACCEL_TABLE_SIZE 32
+
+// clang-format off
+// 添字 = 1レポートの移動量(ACCEL_TABLE_SIZE - 1 で頭打ち)
+// 倍率 = 下限 + (上限 - 下限) × smoothstep(移動量 / 飽和点)
+static const uint16_t PROGMEM accel_table[ACCEL_CURVE_COUNT - 1][ACCEL_TABLE_SIZE] = {
+    [ACCEL_MILD - 1] = {   // 0.625 → 1.75、移動量24で飽和
+        160, 161, 166, 172, 181, 192, 205, 219, 235, 251, 268, 286, 304, 322, 340, 357,
+        373, 389, 403, 416, 427, 436, 442, 447, 448, 448, 448, 448, 448, 448, 448, 448,
+    },
+    [ACCEL_STRONG - 1] = { // 0.5 → 3.0、移動量20で飽和
+        128, 133, 146, 167, 195, 228, 266, 308, 353, 400, 448, 496, 543, 588, 630, 668,
+        701, 729, 750, 763, 768, 768, 768, 768, 768, 768, 768, 768, 768, 768, 768, 768,
+    },
+};
+// clang-format on
+
+static int32_t accel_acc_x;  // 端数(1/256単位)
+static int32_t accel_acc_y;
+
+static mouse_xy_report_t accel_take(int32_t *acc) {
+    int32_t out = *acc / 256;
+    out         = MIN(MAX(out, XY_REPORT_MIN), XY_REPORT_MAX);
+    *acc -= out * 256;
+    return (mouse_xy_report_t)out;
+}
+
+static void accel_apply(report_mouse_t *r) {
+    uint8_t curve = user_config.accel_curve;
+    if (curve == ACCEL_OFF || curve >= ACCEL_CURVE_COUNT) {
+        return;
+    }
+    if (r->x == 0 && r->y == 0) {
+        accel_acc_x = 0;  // 止まったら端数も捨てる(次の動き出しに残さない)
+        accel_acc_y = 0;
+        return;
+    }
+    uint16_t speed = MIN(abs(r->x) + abs(r->y), ACCEL_TABLE_SIZE - 1);
+    int32_t  gain  = pgm_read_word(&accel_table[curve - 1][speed]);
+    accel_acc_x += r->x * gain;
+    accel_acc_y += r->y * gain;
+    r->x = accel_take(&accel_acc_x);
+    r->y = accel_take(&accel_acc_y);
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// オートマウス(Layer 3)
+// 
+// ボールの移動量が AMOUSE_THRESHOLD を超えたら Layer 3 を有効化し、
+// ホームポジションのクリックをコンボ待ちなしで使えるようにする
+// - 解除: 最後の移動/クリックから AMOUSE_TIMEOUT 経過(deferred executor)
+//         またはマウス以外のキーの押下(そのキーは Layer 0 として処理)
+// - 修飾キー(Shift/Cmd/Ctrl)と SLSH_SCRL は解除しない(Shift+クリック等)
+// - Layer 0 の時だけ起動(L1スクロール・L2選択中は起動しない)
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+static bool           amouse_active;
+static uint16_t       amouse_travel;       // 起動前の移動量の累計
+static uint16_t       amouse_last_time;    // 最後の移動/クリック
+static uint8_t        amouse_buttons;      // 押下中のボタン(押している間は解除しない)
+static deferred_token amouse_token = INVALID_DEFERRED_TOKEN;
+
+// 状態だけ戻す(レイヤーは呼び出し側で外す)
+static void amouse_reset(void) {
+    if (amouse_token != INVALID_DEFERRED_TOKEN) {
+        cancel_deferred_exec(amouse_token);
+        amouse_token = INVALID_DEFERRED_TOKEN;
+    }
+    amouse_active  = false;
+    amouse_travel  = 0;
+    amouse_buttons = 0;
+}
+
+static void amouse_off(void) {
+    amouse_reset();
+    layer_off(AMOUSE_LAYER);
+}
+
+static uint32_t amouse_timeout(uint32_t trigger_time, void *cb_arg) {
+    uint16_t elapsed = timer_elapsed(amouse_last_time);
+    if (amouse_buttons || elapsed < AMOUSE_TIMEOUT) {
+        // ドラッグ中、または最後の操作から時間が経っていない: 残り時間で再予約
+        return amouse_buttons ? AMOUSE_TIMEOUT : AMOUSE_TIMEOUT - elapsed;
+    }
+    amouse_token = INVALID_DEFERRED_TOKEN;
+    amouse_off();
+    return 0;
+}
+
+static void amouse_on_motion(int16_t x, int16_t y) {
+    if (x == 0 && y == 0) {
+        return;
+    }
+    if (!amouse_active) {
+        if (get_highest_layer(layer_state) != 0 || user_config.keymap_profile != KEYMAP_MAIN) {
+            return;
+        }
+        // 前回の移動から時間が空いたら累計をやり直す(机の振動などで起動しない)
+        if (timer_elapsed(amouse_last_time) >= AMOUSE_TIMEOUT) {
+            amouse_travel = 0;
+        }
+        amouse_last_time = timer_read();
+        amouse_travel += abs(x) + abs(y);
+        if (amouse_travel < AMOUSE_THRESHOLD) {
+            return;
+        }
+        amouse_active = true;
+        amouse_token  = defer_exec(AMOUSE_TIMEOUT, amouse_timeout, NULL);
+        layer_on(AMOUSE_LAYER);
+    }
+    amouse_last_time = timer_read();
+}
+
+// マウス操作中も押せるキー(押しても解除しない)
+static bool amouse_is_mouse_friendly(uint16_t keycode) {
+    return IS_MOUSEKEY_BUTTON(keycode) || IS_MODIFIER_KEYCODE(keycode) || IS_QK_MOD_TAP(keycode) || keycode == TAB_CTGUI || keycode == SLSH_SCRL || keycode == GESTURE;
+}
+
+static void amouse_process(uint16_t keycode, keyrecord_t *record) {
+    if (!amouse_active) {
+        return;
+    }
+    if (IS_MOUSEKEY_BUTTON(keycode)) {
+        uint8_t bit = 1 << (keycode - KC_BTN1);
+        if (record->event.pressed) {
+            amouse_buttons |= bit;
+        } else {
+            amouse_buttons &= ~bit;
+        }
+        amouse_last_time = timer_read();
+    } else if (record->event.pressed && !amouse_is_mouse_friendly(keycode)) {
+        amouse_off();
+    }
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// 高解像度スクロール(SLSH_SCRL / L1)
+// 
+// keyball標準はボールの移動量を 2^(div-1) で割ってノッチ単位で送るため、
+// ゆっくり回すと止まって見え、速く回すとカクつく
+// ここではホイールを1ノッチ = 解像度(HIRES_SCROLL_MULTIPLIER)単位で送り、
+// 移動量 × 解像度 を固定小数点で積算して端数を次回に持ち越す
+// - 1レポートに載りきらない分も積算に残す(捨てない)
+// - 端数が1単位に満たない間は 0 のまま(空のレポートは送られない)
+// - スクロールスナップ(SSNP_*)で止めた軸は積算も捨てる
+// ※ POINTING_DEVICE_HIRES_SCROLL_ENABLE が無効なら解像度1(通常ホイール)
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+static int32_t scroll_acc_h;  // 単位: ボール移動量 × 解像度
+static int32_t scroll_acc_v;
+
+// 積算から送れるだけ取り出す(1ノッチ = 2^(div-1) カウント)
+static mouse_hv_report_t scroll_take(int32_t *acc, uint8_t shift) {
+    int32_t out = *acc / ((int32_t)1 << shift);  // 0方向に丸め(端数は符号ごと残る)
+    out         = MIN(MAX(out, -127), 127);
+    *acc -= out * ((int32_t)1 << shift);
+    return (mouse_hv_report_t)out;
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// 慣性スクロール
+// 
+// スクロールモードを抜けた時(SLSH_SCRL / L1 を離した時)にボールが
+// 動いていれば、その速度でスクロールを続けて徐々に減速させる
+// - 速度はスクロール中のレポートから指数移動平均で推定
+//   (単位: 積算と同じ「移動量 × 解像度」/ms、1/16固定小数点)
+// - KINETIC_INTERVAL ごとに deferred executor から送信、毎回 1/KINETIC_DECAY 減速
+// - ボールに触る・キーを押す・スクロールモードに戻ると即停止
+// - KINE_SW でオン/オフ(初期値オフ)
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+#define KINETIC_INTERVAL 16  // 送信間隔(ms)
+#define KINETIC_DECAY 16     // 1回あたりの減速(速度の1/16)
+#define KINETIC_WINDOW 50    // 離す直前これ以内に動いていたら慣性あり(ms)
+#define KINETIC_MIN_SPEED 8  // これより遅くなったら停止(1/16単位)
+
+static int32_t        kinetic_vel_h;  // 速度(1/16単位)
+static int32_t        kinetic_vel_v;
+static uint16_t       kinetic_last_time;
+static deferred_token kinetic_token = INVALID_DEFERRED_TOKEN;
+
+static void kinetic_cancel(void) {
+    if (kinetic_token != INVALID_DEFERRED_TOKEN) {
+        cancel_deferred_exec(kinetic_token);
+        kinetic_token = INVALID_DEFERRED_TOKEN;
+    }
+}
+
+// スクロール中のレポートごとに速度を更新
+static void kinetic_observe(int32_t h, int32_t v) {
+    uint16_t dt = timer_elapsed(kinetic_last_time);
+    kinetic_last_time = timer_read();
+    if (dt >= KINETIC_WINDOW) {
+        // 止まっていた後の最初の動き: 間隔が測れないので速度を捨てる
+        kinetic_vel_h = 0;
+        kinetic_vel_v = 0;
+        return;
+    }
+    dt = MAX(dt, 1);
+    kinetic_vel_h += (h * 16 / dt - kinetic_vel_h) / 4;
+    kinetic_vel_v += (v * 16 / dt - kinetic_vel_v) / 4;
+}
+
+// 1/KINETIC_DECAY 減速(減速分は切り上げ、KINETIC_DECAY 未満の速度でも必ず0に近づく)
+static int32_t kinetic_decay(int32_t vel) {
+    int32_t round = vel > 0 ? KINETIC_DECAY - 1 : vel < 0 ? -(KINETIC_DECAY - 1) : 0;
+    return vel - (vel + round) / KINETIC_DECAY;
+}
+
+static uint32_t kinetic_tick(uint32_t trigger_time, void *cb_arg) {
+    kinetic_vel_h = kinetic_decay(kinetic_vel_h);
+    kinetic_vel_v = kinetic_decay(kinetic_vel_v);
+    if (abs(kinetic_vel_h) < KINETIC_MIN_SPEED && abs(kinetic_vel_v) < KINETIC_MIN_SPEED) {
+        kinetic_token = INVALID_DEFERRED_TOKEN;
+        scroll_acc_h  = 0;
+        scroll_acc_v  = 0;
+        return 0;
+    }
+    scroll_acc_h += kinetic_vel_h * KINETIC_INTERVAL / 16;
+    scroll_acc_v += kinetic_vel_v * KINETIC_INTERVAL / 16;
+
+    uint8_t        shift = keyball_get_scroll_div() - 1;
+    report_mouse_t r     = pointing_device_get_report();
+    r.h                  = scroll_take(&scroll_acc_h, shift);
+    r.v                  = scroll_take(&scroll_acc_v, shift);
+    pointing_device_set_report(r);
+    pointing_device_send();
+    return KINETIC_INTERVAL;
+}
+
+// スクロールモードを抜けた時に呼ぶ
+static void kinetic_start(void) {
+    if (!user_config.kinetic_scroll || timer_elapsed(kinetic_last_time) >= KINETIC_WINDOW) {
+        return;
+    }
+    if (abs(kinetic_vel_h) < KINETIC_MIN_SPEED && abs(kinetic_vel_v) < KINETIC_MIN_SPEED) {
+        return;
+    }
+    kinetic_cancel();
+    kinetic_token = defer_exec(KINETIC_INTERVAL, kinetic_tick, NULL);
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// 自動スクロールスナップ
+// 
+// SSNP_VRT/SSNP_HOR を手で切り替える代わりに、直近の動きの縦横比で
+// スクロール軸を固定する(整数のみ、レポートごとに数回の加算と比較)
+// - 窓: |h|/|v| の指数移動平均(直近4レポート程度)
+// - 固定なし → 片方が他方の SNAP_LOCK_RATIO 倍を超えたらその軸に固定
+// - 固定中 → 他方が SNAP_SWITCH_RATIO 倍を超えたら(明らかに向きが
+//   変わったら)そちらに切替。比を固定より大きくして揺れを防ぐ(ヒステリシス)
+// - SNAP_IDLE_TIME 動きがなければ固定を解除
+// - SNAP_AUTO でオン/オフ、SSNP_* を押すと手動に戻る
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+#define SNAP_LOCK_RATIO 2
+#define SNAP_SWITCH_RATIO 4
+#define SNAP_MIN_TRAVEL 8     // 窓内の移動量がこれ未満なら判定しない
+#define SNAP_IDLE_TIME 300    // ms
+
+static uint16_t                  snap_win_h;
+static uint16_t                  snap_win_v;
+static uint16_t                  snap_last_time;
+static keyball_scrollsnap_mode_t snap_lock = KEYBALL_SCROLLSNAP_MODE_FREE;
+
+static keyball_scrollsnap_mode_t snap_auto_update(int32_t h, int32_t v) {
+    if (h == 0 && v == 0) {
+        return snap_lock;
+    }
+    if (timer_elapsed(snap_last_time) >= SNAP_IDLE_TIME) {
+        snap_win_h = 0;
+        snap_win_v = 0;
+        snap_lock  = KEYBALL_SCROLLSNAP_MODE_FREE;
+    }
+    snap_last_time = timer_read();
+    snap_win_h     = snap_win_h - (snap_win_h >> 2) + MIN(abs(h), 255);
+    snap_win_v     = snap_win_v - (snap_win_v >> 2) + MIN(abs(v), 255);
+
+    uint32_t wh = snap_win_h, wv = snap_win_v;
+    switch (snap_lock) {
+        case KEYBALL_SCROLLSNAP_MODE_VERTICAL:
+            if (wh > wv * SNAP_SWITCH_RATIO) {
+                snap_lock = KEYBALL_SCROLLSNAP_MODE_HORIZONTAL;
+            }
+            break;
+        case KEYBALL_SCROLLSNAP_MODE_HORIZONTAL:
+            if (wv > wh * SNAP_SWITCH_RATIO) {
+                snap_lock = KEYBALL_SCROLLSNAP_MODE_VERTICAL;
+            }
+            break;
+        default:
+            if (wh + wv < SNAP_MIN_TRAVEL) {
                 break;
+            }
+            if (wv > wh * SNAP_LOCK_RATIO) {
+                snap_lock = KEYBALL_SCROLLSNAP_MODE_VERTICAL;
+            } else if (wh > wv * SNAP_LOCK_RATIO) {
+                snap_lock = KEYBALL_SCROLLSNAP_MODE_HORIZONTAL;
+            }
+            break;
+    }
+    return snap_lock;
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// スクロールモード切替・スクロールレポート作成
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+// スクロールモードの切替
+// 終了時: 動いていれば慣性スクロールへ、止まっていれば持ち越し分を捨てる
+static void scroll_set_mode(bool on) {
+    if (keyball_get_scroll_mode() == on) {
+        return;  // 変化なし(レイヤー切替のたびに呼ばれる)
+    }
+    if (on) {
+        kinetic_cancel();
+    } else {
+        scroll_acc_h = 0;
+        scroll_acc_v = 0;
+        kinetic_start();
+    }
+    keyball_set_scroll_mode(on);
+}
+
+void keyball_on_apply_motion_to_mouse_scroll(keyball_motion_t *m, report_mouse_t *r, bool is_left) {
+#ifdef POINTING_DEVICE_HIRES_SCROLL_ENABLE
+    int32_t res = pointing_device_get_hires_scroll_resolution();
+#else
+    int32_t res = 1;
+#endif
+    // Keyball39: センサーのY → 横、X → 縦(左手側は反転)
+    int32_t h = m->y, v = -m->x;
+    if (is_left) {
+        h = -h;
+        v = -v;
+    }
+    m->x = 0;
+    m->y = 0;
+    keyball_scrollsnap_mode_t snap = user_config.snap_auto ? snap_auto_update(h, v) : keyball_get_scrollsnap_mode();
+    switch (snap) {
+        case KEYBALL_SCROLLSNAP_MODE_VERTICAL:
+            h            = 0;
+            scroll_acc_h = 0;
+            break;
+        case KEYBALL_SCROLLSNAP_MODE_HORIZONTAL:
+            v            = 0;
+            scroll_acc_v = 0;
+            break;
+        default:
+            break;
+    }
+    if (h != 0 || v != 0) {
+        kinetic_observe(h * res, v * res);  // スナップ後の軸で速度を取る
+    }
+
+    scroll_acc_h += h * res;
+    scroll_acc_v += v * res;
+
+    uint8_t shift = keyball_get_scroll_div() - 1;
+    r->h          = scroll_take(&scroll_acc_h, shift);
+    r->v          = scroll_take(&scroll_acc_v, shift);
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// レイヤー別ポインタプロファイル
+// 
+// レイヤーごとに CPI・スクロール速度・スクロールスナップを切り替える
+// (例: Layer 2 のShift+矢印で選択中はCPIを半分にして細かく合わせる)
+// - CPI は基準値(CPI_I100/CPI_D100 で調整)に対する割合で指定
+// - 0 の項目はそのまま(SSNP_* など手動の設定を上書きしない)
+// - keyball側のRAM上の値と比べ、違う時だけ書く
+//   (CPIの書込みはセンサーへのSPI転送と左右間の同期が発生するため、
+//    打鍵中に何度も起きるレイヤー切替で毎回書かない)
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+#define POINTER_CPI_MAX 119  // PMW3360: 12000 CPI(100単位)
+
+typedef struct {
+    uint8_t cpi_pct;     // 基準CPIに対する%(0 = 基準のまま)
+    uint8_t scroll_div;  // スクロール速度(0 = そのまま)
+    uint8_t snap;        // スクロールスナップ + 1(0 = そのまま)
+} pointer_profile_t;
+
+#define PP_SNAP(mode) ((mode) + 1)
+
+// clang-format off
+static const pointer_profile_t PROGMEM pointer_profiles[] = {
+    [0]            = {   0, 0, 0 },  // Base
+    [1]            = {   0, 0, 0 },  // Symbols(スクロール)
+    [2]            = {  50, 0, 0 },  // Selection: 細かい操作用
+    [AMOUSE_LAYER] = {   0, 0, 0 },  // オートマウス
+};
+// clang-format on
+
+static uint8_t pointer_base_cpi;  // CPI_I100/CPI_D100 で変える基準値(KBC_SAVEで保存される値、KBC_RSTで既定値)
+
+static void pointer_set_cpi(uint8_t cpi) {
+    if (keyball_get_cpi() != cpi) {
+        keyball_set_cpi(cpi);
+    }
+}
+
+static void pointer_profile_apply(uint8_t layer) {
+    pointer_profile_t pp = {0};
+    if (user_config.keymap_profile != KEYMAP_MAIN) {
+        layer = 0;  // レイヤーの意味が違うので Base の設定のまま
+    }
+    if (layer < sizeof(pointer_profiles) / sizeof(pointer_profiles[0])) {
+        memcpy_P(&pp, &pointer_profiles[layer], sizeof(pp));
+    }
+
+    uint8_t cpi = pointer_base_cpi;
+    if (pp.cpi_pct) {
+        cpi = MAX((uint16_t)cpi * pp.cpi_pct / 100, 1);
+    }
+    pointer_set_cpi(cpi);
+
+    if (pp.scroll_div && keyball_get_scroll_div() != pp.scroll_div) {
+        keyball_set_scroll_div(pp.scroll_div);
+    }
+    if (pp.snap) {
+        keyball_scrollsnap_mode_t snap = (keyball_scrollsnap_mode_t)(pp.snap - 1);
+        if (keyball_get_scrollsnap_mode() != snap) {
+            keyball_set_scrollsnap_mode(snap);
+        }
+    }
+}
+
+// CPI_I100/CPI_D100: 基準値を変えて今のレイヤーの割合で掛け直す
+static void pointer_adjust_base_cpi(int8_t delta) {
+    pointer_base_cpi = MIN(MAX(pointer_base_cpi + delta, 1), POINTER_CPI_MAX);
+    pointer_profile_apply(get_highest_layer(layer_state));
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// ジェスチャー
+// 
+// GESTURE を押している間はポインタを動かさず、ボールの移動量を貯めて
+// 上下左右のスワイプとして判定、OSに合わせたショートカットを送る
+// - 判定: 主軸の移動量が GESTURE_THRESHOLD を超え、かつ
+//         副軸の GESTURE_RATIO 倍以上(斜めは無視)
+// - 1回発動したら貯めた量を捨てる(押したまま続けて弾ける)
+// - 送信は tap_code16_fast(修飾込みで1レポート)
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+#define GESTURE_THRESHOLD 80  // 発動に必要な移動量(カウント)
+#define GESTURE_RATIO 2
+
+enum gesture_dirs {
+    GESTURE_UP,
+    GESTURE_DOWN,
+    GESTURE_LEFT,
+    GESTURE_RIGHT,
+    GESTURE_DIR_COUNT,
+};
+
+typedef struct {
+    uint16_t mac;
+    uint16_t win;
+} gesture_action_t;
+
+// clang-format off
+static const gesture_action_t PROGMEM gesture_actions[GESTURE_DIR_COUNT] = {
+    //                    Mac              Windows
+    [GESTURE_UP]    = { C(KC_UP),        G(KC_TAB)        },  // Mission Control / タスクビュー
+    [GESTURE_DOWN]  = { C(KC_DOWN),      G(KC_D)          },  // アプリExposé / デスクトップ表示
+    [GESTURE_LEFT]  = { C(KC_LEFT),      C(G(KC_LEFT))    },  // 左のデスクトップ
+    [GESTURE_RIGHT] = { C(KC_RGHT),      C(G(KC_RGHT))    },  // 右のデスクトップ
+};
+// clang-format on
+
+static bool    gesture_active;
+static int16_t gesture_x;
+static int16_t gesture_y;
+
+static void gesture_fire(uint8_t dir) {
+    const gesture_action_t *action = &gesture_actions[dir];
+    tap_code16_fast(pgm_read_word(host.is_mac ? &action->mac : &action->win));
+    gesture_x = 0;
+    gesture_y = 0;
+}
+
+// GESTURE 押下中はレポートの移動を横取りする
+static void gesture_process_motion(report_mouse_t *r) {
+    if (!gesture_active) {
+        return;
+    }
+    gesture_x = MIN(MAX(gesture_x + r->x, -1000), 1000);
+    gesture_y = MIN(MAX(gesture_y + r->y, -1000), 1000);
+    r->x      = 0;
+    r->y      = 0;
+
+    uint16_t ax = abs(gesture_x), ay = abs(gesture_y);
+    if (ax >= GESTURE_THRESHOLD && ax >= ay * GESTURE_RATIO) {
+        gesture_fire(gesture_x < 0 ? GESTURE_LEFT : GESTURE_RIGHT);
+    } else if (ay >= GESTURE_THRESHOLD && ay >= ax * GESTURE_RATIO) {
+        gesture_fire(gesture_y < 0 ? GESTURE_UP : GESTURE_DOWN);
+    }
+}
+
+#ifdef OLED_ENABLE
+// OLED差分描画の入力(OLED表示設定参照)
+static bool           oled_redraw_all = true;  // 次の描画で全行を書く
+static uint8_t        oled_key_events;         // キーイベントごとに+1
+static report_mouse_t oled_ball_seen;          // keyballが表示する直近のレポート
+#endif
+
+// ポインタレポートの最終段(keyballの処理後に呼ばれる)
+report_mouse_t pointing_device_task_user(report_mouse_t mouse_report) {
+    uint32_t start = prof_now();
+#ifdef OLED_ENABLE
+    oled_ball_seen = mouse_report;
+#endif
+    if (mouse_report.x != 0 || mouse_report.y != 0 || mouse_report.h != 0 || mouse_report.v != 0) {
+        boot_mark(&boot_first_pointer_ms);
+    }
+    if (mouse_report.x != 0 || mouse_report.y != 0) {
+        kinetic_cancel();  // ボールに触ったら慣性を止める
+    }
+    gesture_process_motion(&mouse_report);
+    accel_apply(&mouse_report);
+    amouse_on_motion(mouse_report.x, mouse_report.y);
+    prof_add(PROF_POINTER, start);
+    return mouse_report;
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// コンボエンジン(マトリクス位置で索引)
+// 
+// 起動時(とキーマップ切替時)に Layer 0 を走査し「位置 → そのキーを含むコンボ」の
+// ビットマスク表を作る。キーごとの処理は表を1回引くだけで、
+// コンボの数が増えても1イベントあたりのコストは一定(tools/host/combo_bench.c で計測)
+// - 候補なしのキー: 何もせず通す
+// - 候補ありのキー: COMBO_TERM だけ保留し、次のキーの候補と
+//   AND が取れればコンボ発動、取れなければ保留分を再生
+// - 保留分は action_tapping_process() で再生(Tap-Hold判定も元の時刻で)
+// - Layer 0 以外・連続打鍵中は判定しない
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+static combo_mask_t   combo_index[MATRIX_ROWS][MATRIX_COLS];
+static keyrecord_t    combo_pending;       // 保留中の押下
+static combo_mask_t   combo_pending_mask;  // 0 = 保留なし
+static deferred_token combo_token = INVALID_DEFERRED_TOKEN;
+static uint16_t       combo_active_action;  // 発動中のコンボ
+static keypos_t       combo_active_keys[2];
+static uint8_t        combo_active_held;  // 離されていないキー(bit0/bit1)
+
+static void combo_index_build(void) {
+    memset(combo_index, 0, sizeof(combo_index));
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            uint16_t keycode = keymap_key_to_keycode(0, (keypos_t){.row = row, .col = col});
+            for (uint8_t i = 0; i < USER_COMBO_COUNT; i++) {
+                if (!(pgm_read_byte(&user_combos[i].keymaps) & (1 << user_config.keymap_profile))) {
+                    continue;
+                }
+                if (pgm_read_word(&user_combos[i].keys[0]) == keycode || pgm_read_word(&user_combos[i].keys[1]) == keycode) {
+                    combo_index[row][col] |= (combo_mask_t)1 << i;
+                }
+            }
+        }
+    }
+}
+
+static bool combo_same_pos(keypos_t a, keypos_t b) {
+    return a.row == b.row && a.col == b.col;
+}
+
+// 保留していた押下を通常のキーとして流す
+static void combo_flush(void) {
+    if (combo_pending_mask) {
+        combo_pending_mask = 0;
+        if (combo_token != INVALID_DEFERRED_TOKEN) {
+            cancel_deferred_exec(combo_token);
+            combo_token = INVALID_DEFERRED_TOKEN;
+        }
+        action_tapping_process(combo_pending);
+    }
+}
+
+static uint32_t combo_timeout(uint32_t trigger_time, void *cb_arg) {
+    combo_token = INVALID_DEFERRED_TOKEN;
+    combo_flush();
+    return 0;
+}
+
+// コンボの出力は通常のキーと同じ順で処理する
+// (process_record_user → QMKのアクション → post_process_record_user)
+// カスタムキー(IME_TOGGLE 等)もマウスボタン(KC_BTN1 等)も1つの経路で送れる
+static void combo_send(uint16_t action, keyrecord_t *record) {
+    if (process_record_user(action, record)) {
+        process_action(record, action_for_keycode(action));
+        post_process_record_user(action, record);
+    }
+}
+
+// false: このイベントはコンボで消費した
+static bool combo_process(keyrecord_t *record) {
+    keypos_t pos = record->event.key;
+    if (pos.row >= MATRIX_ROWS || pos.col >= MATRIX_COLS) {
+        return true;
+    }
+
+    if (!record->event.pressed) {
+        // 発動中コンボのキー: 最初のリリースでコンボを離し、両方のリリースを消費
+        for (uint8_t i = 0; i < 2; i++) {
+            if ((combo_active_held & (1 << i)) && combo_same_pos(pos, combo_active_keys[i])) {
+                if (combo_active_held == 0x3) {
+                    combo_send(combo_active_action, record);
+                }
+                combo_active_held &= ~(1 << i);
+                return false;
+            }
+        }
+        // 保留中にどのキーが離されても、押下を先に流してからリリースを通す
+        // (Shift を離す前に押した J が Shift なしで出ないように)
+        combo_flush();
+        return true;
+    }
+
+    combo_mask_t candidates = 0;
+    if (get_highest_layer(layer_state) == 0 && !streak_active && !combo_active_held) {
+        candidates = combo_index[pos.row][pos.col];
+    }
+
+    if (combo_pending_mask) {
+        combo_mask_t hit = candidates & combo_pending_mask;
+        if (hit) {
+            uint8_t i = sizeof(hit) > sizeof(unsigned) ? __builtin_ctzll(hit) : __builtin_ctz(hit);
+            cancel_deferred_exec(combo_token);
+            combo_token          = INVALID_DEFERRED_TOKEN;
+            combo_pending_mask   = 0;
+            combo_active_action  = pgm_read_word(&user_combos[i].action);
+            combo_active_keys[0] = combo_pending.event.key;
+            combo_active_keys[1] = pos;
+            combo_active_held    = 0x3;
+            record->event.time   = combo_pending.event.time;  // 遅延計測は1キー目から
+            combo_send(combo_active_action, record);
+            return false;
+        }
+        combo_flush();
+    }
+
+    if (candidates) {
+        combo_pending      = *record;
+        combo_pending_mask = candidates;
+        combo_token        = defer_exec(COMBO_TERM, combo_timeout, NULL);
+        return false;
+    }
+    return true;
+}
+
+// コンボ・Tap-Holdより前に全イベントが通る
+bool pre_process_record_user(uint16_t keycode, keyrecord_t *record) {
+    heat_record_press(record);
+    streak_update(keycode, record);
+    if (record->event.pressed) {
+        kinetic_cancel();  // キーを押したら慣性を止める
+    }
+    amouse_process(keycode, record);
+    // コンボが先: 保留中の候補を流してから連続打鍵中の Space を送る
+    if (!combo_process(record)) {
+        return false;
+    }
+    return streak_space_process(keycode, record);
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// カスタムTap-Holdエンジン(TAB_CTGUI / SLSH_SCRL)
+// 
+// 押下時は何も送らず「判定待ち」にして、TAPPING_TERM 後に
+// deferred executor からホールドを確定する(スキャン毎のタイマー監視なし)
+// - 判定待ち中に離す → タップ
+// - 判定待ち中に他キーが押された時の扱いはキーごとに選ぶ
+//   CTH_INTERRUPT_PERMISSIVE: 他キーを保留し、他キーが先に離れたらホールド
+//                             自キーが先に離れたらタップ(PERMISSIVE_HOLD相当)
+//   CTH_INTERRUPT_TAP:        即タップ(打鍵順を崩さない)
+// - streak_tap: 連続打鍵中に押されたら判定を待たずタップ
+// 
+// ※ defer_exec を使う(rules.mk の DEFERRED_EXEC_ENABLE)
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+typedef enum {
+    CTH_IDLE,
+    CTH_PENDING,  // 判定待ち
+    CTH_HOLD,     // ホールド確定
+} cth_state_t;
+
+typedef enum {
+    CTH_INTERRUPT_PERMISSIVE,
+    CTH_INTERRUPT_TAP,
+} cth_interrupt_t;
+
+typedef struct {
+    uint16_t        keycode;
+    cth_interrupt_t interrupt;
+    bool            streak_tap;
+    void (*on_tap)(void);
+    void (*on_hold)(bool pressed);  // true=ホールド開始 / false=ホールド終了
+    cth_state_t     state;
+    deferred_token  token;
+    uint16_t        deferred_keycode;  // PERMISSIVE: 保留中の他キー
+} custom_taphold_t;
+
+static void tab_ctgui_tap(void) {
+    tap_code(KC_TAB);
+}
+
+static void tab_ctgui_hold(bool pressed) {
+    if (pressed) {
+        tab_ctgui_mod = host.cmd_mod;  // Mac=Cmd / Win=Ctrl
+        register_code(tab_ctgui_mod);
+    } else {
+        unregister_code(tab_ctgui_mod);
+    }
+}
+
+static void slsh_scrl_tap(void) {
+    tap_code(KC_SLSH);
+}
+
+static void slsh_scrl_hold(bool pressed) {
+    // 離したらL1の状態に戻す(L1が有効ならスクロール継続)
+    is_slash_scroll_active = pressed;
+    scroll_set_mode(pressed || layer_state_cmp(layer_state, 1));
+}
+
+enum cth_keys {
+    CTH_TAB_CTGUI,
+    CTH_SLSH_SCRL,
+    CTH_KEY_COUNT,
+};
+
+static custom_taphold_t cth_keys[CTH_KEY_COUNT] = {
+    // Cmd+C のような素早い修飾操作を拾う
+    [CTH_TAB_CTGUI] = {TAB_CTGUI, CTH_INTERRUPT_PERMISSIVE, false, tab_ctgui_tap, tab_ctgui_hold},
+    // 文字キー扱い: "/a" の打鍵順を保つ
+    [CTH_SLSH_SCRL] = {SLSH_SCRL, CTH_INTERRUPT_TAP, true, slsh_scrl_tap, slsh_scrl_hold},
+};
+
+static void cth_cancel_timer(custom_taphold_t *th) {
+    if (th->token != INVALID_DEFERRED_TOKEN) {
+        cancel_deferred_exec(th->token);
+        th->token = INVALID_DEFERRED_TOKEN;
+    }
+}
+
+// 保留していた他キーは押されたままなので、判定後に押下を送る
+static void cth_flush_deferred(custom_taphold_t *th) {
+    if (th->deferred_keycode != KC_NO) {
+        register_code16(th->deferred_keycode);
+        th->deferred_keycode = KC_NO;
+    }
+}
+
+static void cth_resolve_tap(custom_taphold_t *th) {
+    cth_cancel_timer(th);
+    th->state = CTH_IDLE;
+    th->on_tap();
+    cth_flush_deferred(th);
+}
+
+static void cth_resolve_hold(custom_taphold_t *th) {
+    cth_cancel_timer(th);
+    th->state = CTH_HOLD;
+    th->on_hold(true);
+    cth_flush_deferred(th);
+}
+
+static uint32_t cth_timeout(uint32_t trigger_time, void *cb_arg) {
+    custom_taphold_t *th = (custom_taphold_t *)cb_arg;
+    th->token            = INVALID_DEFERRED_TOKEN;
+    if (th->state == CTH_PENDING) {
+        cth_resolve_hold(th);
+    }
+    return 0;
+}
+
+static bool cth_process(custom_taphold_t *th, keyrecord_t *record) {
+    if (record->event.pressed) {
+        if (th->streak_tap && streak_active) {
+            th->on_tap();  // 単語の途中: 判定待ちなし
+            th->state = CTH_IDLE;
+            return false;
+        }
+        th->state            = CTH_PENDING;
+        th->deferred_keycode = KC_NO;
+        th->token            = defer_exec(get_tapping_term(th->keycode, record), cth_timeout, th);
+    } else if (th->state == CTH_PENDING) {
+        cth_resolve_tap(th);
+    } else if (th->state == CTH_HOLD) {
+        th->on_hold(false);
+        th->state = CTH_IDLE;
+    }
+    return false;
+}
+
+// 判定待ちのキーがある時に他キーが来たら割り込み判定
+// false: このイベントは保留した(呼び出し元は処理を止める)
+static bool cth_process_other(uint16_t keycode, keyrecord_t *record) {
+    for (uint8_t i = 0; i < CTH_KEY_COUNT; i++) {
+        custom_taphold_t *th = &cth_keys[i];
+        if (th->state != CTH_PENDING || th->keycode == keycode) {
+            continue;
+        }
+        if (record->event.pressed) {
+            if (th->interrupt == CTH_INTERRUPT_TAP) {
+                cth_resolve_tap(th);
+            } else if (th->interrupt == CTH_INTERRUPT_PERMISSIVE && th->deferred_keycode == KC_NO && IS_BASIC_KEYCODE(keycode)) {
+                th->deferred_keycode = keycode;
+                return false;
+            } else {
+                // 保留できないキー(レイヤーキー等)は即ホールド
+                cth_resolve_hold(th);
+            }
+        } else if (th->deferred_keycode != KC_NO && keycode == th->deferred_keycode) {
+            // 保留中の他キーが先に離された → ホールドで修飾して送る
+            th->deferred_keycode = KC_NO;
+            cth_resolve_hold(th);
+            tap_code(keycode);
+            return false;
+        }
+    }
+    return true;
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// 適応Tapping Term
+// 
+// 二役キーごとに押下時間を記録し、その人のタップの長さから
+// タップ/ホールドのしきい値を学習する
+// - タップ: 押下時間で平均と偏差を更新(指数移動平均、1/16)
+// - ホールドは標本にしない(他キーを挟まないホールドも遅いタップとは
+//   限らず、数えるとしきい値が伸び続ける)
+// - しきい値 = 平均 + 4×偏差 + 10ms を MIN〜MAX に制限
+// - 統計は TT_SAVE_INTERVAL ごと、TT_SAVE_IDLE 打鍵がない時にまとめて保存
+//   (打鍵中はEEPROMに書かない、ヒートマップと同じ)
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+#define TT_MARGIN 10
+#define TT_SAVE_INTERVAL (10 * 60 * 1000UL)  // ms
+#define TT_SAVE_IDLE 3000                    // ms
+
+static uint16_t tt_term[TT_KEY_COUNT];
+static uint16_t tt_press_time[TT_KEY_COUNT];
+static uint32_t tt_last_sample;
+
+static int8_t tt_index(uint16_t keycode) {
+    switch (keycode) {
+        case LT(1, KC_ESC):
+            return TT_ESC_L1;
+        case LT(2, KC_SPC):
+            return TT_SPC_L2;
+        case GUI_T(IME_OFF):
+            return TT_IME_OFF;
+        case SFT_T(IME_ON):
+            return TT_IME_ON;
+        case TAB_CTGUI:
+            return TT_TAB_CTGUI;
+        default:
+            return -1;
+    }
+}
+
+static void tt_update_term(uint8_t i) {
+    const tt_stats_t *s    = &user_config.tt[i];
+    uint16_t          term = (s->tap_avg + 4 * s->tap_dev) / 16 + TT_MARGIN;
+    tt_term[i]             = MIN(MAX(term, TAPPING_TERM_MIN), TAPPING_TERM_MAX);
+}
+
+static void tt_init(void) {
+    for (uint8_t i = 0; i < TT_KEY_COUNT; i++) {
+        tt_update_term(i);
+    }
+}
+
+static void tt_add_tap_sample(uint8_t i, uint16_t duration) {
+    tt_stats_t *s     = &user_config.tt[i];
+    int16_t     delta = (int16_t)(MIN(duration, 1000) * 16 - s->tap_avg);
+    s->tap_avg += delta / 16;
+    s->tap_dev += (int16_t)(abs(delta) - s->tap_dev) / 16;
+    tt_update_term(i);
+
+    user_config_dirty = true;
+    tt_last_sample    = timer_read32();
+}
+
+// housekeeping_task_user から呼ぶ
+static void tt_task(void) {
+    if (user_config_dirty && timer_elapsed32(user_config_save_time) >= TT_SAVE_INTERVAL && timer_elapsed32(tt_last_sample) >= TT_SAVE_IDLE) {
+        user_config_save();
+    }
+}
+
+// 押下時間を記録(処理前に呼ぶ)
+// is_tap: このリリースがタップとして処理されるか
+static void tt_observe(uint16_t keycode, keyrecord_t *record, bool is_tap) {
+    int8_t i = tt_index(keycode);
+    if (i < 0) {
+        return;
+    }
+    if (record->event.pressed) {
+        tt_press_time[i] = record->event.time;
+    } else if (is_tap) {
+        tt_add_tap_sample(i, TIMER_DIFF_16(record->event.time, tt_press_time[i]));
+    }
+}
+
+uint16_t get_tapping_term(uint16_t keycode, keyrecord_t *record) {
+    int8_t i = tt_index(keycode);
+    return i >= 0 ? tt_term[i] : TAPPING_TERM;
+}
+
+// キーマップの選択(起動時と KEYMAP_SW から)
+static void keymap_select(uint8_t profile) {
+    if (profile >= KEYMAP_PROFILE_COUNT) {
+        profile = KEYMAP_MAIN;
+    }
+    user_config.keymap_profile = profile;
+    keymap_active              = profile == KEYMAP_39_02 ? keymaps_39_02 : keymaps;
+    combo_index_build();
+}
+
+// KEYMAP_SW: KEYMAP_SW_HOLD 押し続けたら切替、それより短ければ ESC
+// (Layer 2 では ESC/L1 の位置なので、単押しは透過していた時と同じ ESC)
+// 押しているキー・レイヤーは切替前の表のものなので全部離す
+#define KEYMAP_SW_HOLD 1000  // ms
+
+static deferred_token keymap_sw_token = INVALID_DEFERRED_TOKEN;
+
+static uint32_t keymap_sw_timeout(uint32_t trigger_time, void *cb_arg) {
+    keymap_sw_token = INVALID_DEFERRED_TOKEN;
+    heat_flush();
+    keymap_select((user_config.keymap_profile + 1) % KEYMAP_PROFILE_COUNT);
+    heat_load(user_config.keymap_profile);
+    user_config_save();
+    amouse_reset();
+    layer_clear();
+    clear_keyboard();
+    return 0;
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// カスタムキー処理(Windows/Mac両対応)
+// 
+// 【IME_ON】単押し=かな/変換(長押しShiftはSFT_Tで処理)
+// 【IME_OFF】単押し=英数/無変換(長押しCmdはGUI_Tで処理)
+// 【APP_SW】アプリ切替(Mac=Cmd+Tab / Win=Alt+Tab)
+// 【IME_TOGGLE】かな/英数トグル
+// 【OS_CTRL_GUI】OSに応じてCtrl/Cmd切替
+// 【SLSH_SCRL】単押し=/ / 長押し=スクロールモード
+// 【HOST_SW】ホストOSの手動上書き(OS判定が外れた時用)
+// 【STAT_PG】統計ページ切替
+// 【ACCEL_SW】ポインタ加速カーブ切替(保存は KBC_SAVE)
+// 【KINE_SW】慣性スクロールのオン/オフ(保存は KBC_SAVE)
+// 【SNAP_AUTO】スクロールスナップ自動のオン/オフ(保存は KBC_SAVE)
+// 【GESTURE】押している間ボールの動きをジェスチャーとして判定
+// 【KEYMAP_SW】長押しでキーマップ切替(すぐEEPROMへ保存)、単押し=ESC
+// 【JU_*】ju_table でOS別キーコードに変換、修飾込みで1レポート送信
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// IME状態保持用(直前に送ったIMEキー、トグルの基準・副側OLEDの表示に使う)
+static bool ime_toggle_state = false; // false: OFF(英数), true: ON(かな)
+
+static bool process_record_keymap(uint16_t keycode, keyrecord_t *record) {
+    switch (keycode) {
+        // 英数/Cmd・かな/Shift の親指キー
+        // GUI_T()/SFT_T() は基本キーコードしか持てないので、タップだけここで差し替える
+        // (ホールドの Cmd/Shift はQMKが処理)
+        case GUI_T(IME_OFF):
+            if (record->tap.count) {
+                if (record->event.pressed) {
+                    ime_toggle_state = false;
+                    tap_code(host.ime_off);
+                }
+                return false;
+            }
+            return true;
+
+        case SFT_T(IME_ON):
+            if (record->tap.count) {
+                if (record->event.pressed) {
+                    ime_toggle_state = true;
+                    tap_code(host.ime_on);
+                }
+                return false;
+            }
+            return true;
+
+        // かな/変換(タップ専用、ホールドはSFT_Tで処理)
+        case IME_ON:
+            if (record->event.pressed) {
+                ime_toggle_state = true;
+                tap_code(host.ime_on);
+            }
+            return false;
+
+        // 英数/無変換(タップ専用、ホールドはGUI_Tで処理)
+        case IME_OFF:
+            if (record->event.pressed) {
+                ime_toggle_state = false;
+                tap_code(host.ime_off);
+            }
+            return false;
+
+        // OSでCmd/Ctrl切替(親指キー) - タップ=Tab / ホールド=Ctrl(Win)/Cmd(Mac)
+        case TAB_CTGUI:
+            return cth_process(&cth_keys[CTH_TAB_CTGUI], record);
+
+        // かな/英数トグル
+        case IME_TOGGLE:
+            if (record->event.pressed) {
+                ime_toggle_state = !ime_toggle_state;
+                tap_code(ime_toggle_state ? host.ime_on : host.ime_off);
+            }
+            return false;
+
+        // アプリ切替(Mac=Cmd+Tab / Win=Alt+Tab)
+        case APP_SW:
+            if (record->event.pressed) {
+                if (!is_app_sw_active) {
+                    is_app_sw_active = true;
+                    // OSに応じた修飾キーを保持(Mac=Cmd / Win=Alt)
+                    app_sw_mod = host.app_sw_mod;
+                    register_code(app_sw_mod);
+                }
+                tap_code(KC_TAB);  // Tab送信
+            }
+            return false;
+
+        // /キー: タップ=/ / ホールド=スクロールモード
+        case SLSH_SCRL:
+            return cth_process(&cth_keys[CTH_SLSH_SCRL], record);
+
+        // ホストOS手動切替: 自動 → Mac → Win → 自動
+        case HOST_SW:
+            if (record->event.pressed) {
+                host_override = (host_override + 1) % HOST_OVERRIDE_COUNT;
+                host_profile_refresh();
+            }
+            return false;
+
+        // 統計ページ切替
+        case STAT_PG:
+            if (record->event.pressed) {
+                stat_page = (stat_page + 1) % STAT_PAGE_COUNT;
+#ifdef OLED_ENABLE
+                oled_clear();
+                oled_redraw_all = true;
+#endif
+                stat_page_dump();
+            }
+            return false;
+
+        // ポインタ加速カーブ切替: なし → 弱 → 強
+        case ACCEL_SW:
+            if (record->event.pressed) {
+                user_config.accel_curve = (user_config.accel_curve + 1) % ACCEL_CURVE_COUNT;
+            }
+            return false;
+
+        // 慣性スクロールのオン/オフ
+        case KINE_SW:
+            if (record->event.pressed) {
+                user_config.kinetic_scroll = !user_config.kinetic_scroll;
+            }
+            return false;
+
+        // CPI調整: レイヤー別プロファイルの基準値を変える
+        case CPI_I100:
+        case CPI_D100:
+            if (record->event.pressed) {
+                pointer_adjust_base_cpi(keycode == CPI_I100 ? 1 : -1);
+            }
+            return false;
+
+        // ジェスチャー(押している間)
+        case GESTURE:
+            gesture_active = record->event.pressed;
+            gesture_x      = 0;
+            gesture_y      = 0;
+            return false;
+
+        // キーマップ切替(長押し)
+        case KEYMAP_SW:
+            if (record->event.pressed) {
+                keymap_sw_token = defer_exec(KEYMAP_SW_HOLD, keymap_sw_timeout, NULL);
+            } else if (keymap_sw_token != INVALID_DEFERRED_TOKEN) {
+                cancel_deferred_exec(keymap_sw_token);
+                keymap_sw_token = INVALID_DEFERRED_TOKEN;
+                tap_code(KC_ESC);
+            }
+            return false;
+
+        // スクロールスナップ自動のオン/オフ
+        case SNAP_AUTO:
+            if (record->event.pressed) {
+                user_config.snap_auto = !user_config.snap_auto;
+                snap_lock             = KEYBALL_SCROLLSNAP_MODE_FREE;
+            }
+            return false;
+
+        // 手動のスクロールスナップを選んだら自動をやめる(設定はkeyball側)
+        case SSNP_VRT:
+        case SSNP_HOR:
+        case SSNP_FRE:
+            if (record->event.pressed) {
+                user_config.snap_auto = false;
+            }
+            return true;
+
+        // keyball設定の保存(CPI等)に合わせてユーザー設定も保存
+        // keyballは今のCPIを保存するので、一旦基準値に戻す(離した時に掛け直す)
+        case KBC_SAVE:
+            if (record->event.pressed) {
+                user_config_save();
+                pointer_set_cpi(pointer_base_cpi);
+            } else {
+                pointer_profile_apply(get_highest_layer(layer_state));
+            }
+            return true;  // keyball側の保存も実行
+    }
+
+    // JIS/US両対応キーコード(テーブル変換、下記 ju_table 参照)
+    if (keycode >= JU_FIRST && keycode <= JU_LAST) {
+        if (record->event.pressed) {
+            tap_code16_fast(ju_translate(keycode));
         }
+        return false;
+    }
+    return true;
+}
+
+static bool process_record_user_body(uint16_t keycode, keyrecord_t *record) {
+    if (!cth_process_other(keycode, record)) {
+        return false;  // Tap-Hold判定まで保留
+    }
+    if (keycode == TAB_CTGUI) {
+        tt_observe(keycode, record, cth_keys[CTH_TAB_CTGUI].state == CTH_PENDING);
+    } else {
+        tt_observe(keycode, record, record->tap.count > 0);
+    }
+    if (process_record_keymap(keycode, record)) {
+        return true;  // QMK側で送信 → post_process_record_user で計測
+    }
+    keylat_record(record);  // ここで送信済み
+    return false;
+}
+
+bool process_record_user(uint16_t keycode, keyrecord_t *record) {
+#ifdef OLED_ENABLE
+    oled_key_events++;  // keyballはこの直前に表示用のキー情報を更新している
+#endif
+    heat_record_layer(record);
+    uint32_t start = prof_now();
+    bool     ret   = process_record_user_body(keycode, record);
+    prof_add(PROF_RECORD, start);
+    return ret;
+}
+
+void post_process_record_user(uint16_t keycode, keyrecord_t *record) {
+    // KBC_RST: keyball は process_record_user の後で CPI を既定値に戻すので、
+    // ここで基準値に取り込む(古い基準値で掛け直さないように)
+    if (keycode == KBC_RST && record->event.pressed) {
+        pointer_base_cpi = keyball_get_cpi();
+        pointer_profile_apply(get_highest_layer(layer_state));
+    }
+    if (IS_QK_MOMENTARY(keycode) || (IS_QK_LAYER_TAP(keycode) && record->tap.count == 0)) {
+        return;  // レイヤー切替だけ(送信なし)
+    }
+    keylat_record(record);
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// 左右同期(IME・ホストOS・モード)
+// 
+// 状態はUSB側(マスター)にしかないので、1バイトにまとめて副側へ送る
+// - 送るのは値が変わった時だけ(毎スキャンの同期には載せない)
+// - 送信に失敗したら次のループで再送
+// - 副側は受け取った値でOLEDを描き直す(OLED表示設定参照)
+// ※ トラックボールの移動量はここでは送らない。keyball本体の
+//   KEYBALL_GET_MOTION(固定長・KEYBALL_TX_GETMOTION_INTERVAL 周期)が
+//   運ぶので、圧縮や周期の可変化は keyball.c 側の変更になる
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+#define SPLIT_STATE_IME (1 << 0)     // かな
+#define SPLIT_STATE_MAC (1 << 1)     // Mac向けに送信中
+#define SPLIT_STATE_SCROLL (1 << 2)  // スクロールモード
+#define SPLIT_STATE_APP_SW (1 << 3)  // アプリ切替中
+#define SPLIT_STATE_OVERRIDE_SHIFT 4 // ホストOSの手動上書き(2bit)
+#define SPLIT_STATE_NONE 0xFF        // 未送信(実際の値には現れない)
+
+static uint8_t split_state_sent     = SPLIT_STATE_NONE;  // マスター: 最後に送れた値
+static uint8_t split_state_received = 0;                 // 副側: 受け取った値
+
+static uint8_t split_state_pack(void) {
+    uint8_t state = host_override << SPLIT_STATE_OVERRIDE_SHIFT;
+    if (ime_toggle_state) {
+        state |= SPLIT_STATE_IME;
+    }
+    if (host.is_mac) {
+        state |= SPLIT_STATE_MAC;
+    }
+    if (keyball_get_scroll_mode()) {
+        state |= SPLIT_STATE_SCROLL;
+    }
+    if (is_app_sw_active) {
+        state |= SPLIT_STATE_APP_SW;
+    }
+    return state;
+}
+
+static void split_state_receive(uint8_t in_buflen, const void *in_data, uint8_t out_buflen, void *out_data) {
+    if (in_buflen == sizeof(split_state_received)) {
+        split_state_received = *(const uint8_t *)in_data;
+    }
+}
+
+static void split_state_task(void) {
+    if (!is_keyboard_master()) {
+        return;
+    }
+    uint8_t state = split_state_pack();
+    if (state != split_state_sent && transaction_rpc_send(USER_SYNC_STATE, sizeof(state), &state)) {
+        split_state_sent = state;
+    }
+}
+
+void housekeeping_task_user(void) {
+    uint32_t start = prof_now();
+    split_state_task();
+    prof_add(PROF_SPLIT, start);
+    heat_task();
+    tt_task();
+    prof_loop_end();
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// 初期化
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+void keyboard_post_init_user(void) {
+    eeconfig_read_user_datablock(&user_config);
+    if (user_config.version != USER_CONFIG_VERSION) {
+        eeconfig_init_user();
+    }
+
+    // 起動直後はまだOS判定が出ていないので、前回のホストのOSで始める
+    host_detected_os = detected_host_os();
+    if (host_detected_os == OS_UNSURE) {
+        host_detected_os = user_config.last_host_os;
+    }
+    host_profile_refresh();
+    tt_init();
+    keymap_select(user_config.keymap_profile);  // コンボ索引もここで作る
+    heat_load(user_config.keymap_profile);
+    pointer_base_cpi = keyball_get_cpi();  // keyballがEEPROMから読んだ値
+    transaction_register_rpc(USER_SYNC_STATE, split_state_receive);
+    defer_exec(BOOT_OLED_DELAY, boot_oled_start, NULL);  // OLEDは後から
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// レイヤー状態管理
+// 
+// - Layer 1でスクロールモードを有効化
+// - Layer 2を離れたらアプリ切替を解放
+// - SLSH_SCRLとの競合を考慮
+// - L1/L2に入ったらオートマウス(L3)を解除(L3が上に被らないように)
+// - 最上位レイヤーのポインタプロファイルを適用
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+layer_state_t layer_state_set_user(layer_state_t state) {
+    if (amouse_active && (layer_state_cmp(state, 1) || layer_state_cmp(state, 2))) {
+        amouse_reset();
+        state &= ~((layer_state_t)1 << AMOUSE_LAYER);
+    }
+
+    // L2を離れたらアプリ切替を解放
+    if (!layer_state_cmp(state, 2) && is_app_sw_active) {
+        unregister_code(app_sw_mod);
         is_app_sw_active = false;
     }
     
     // スクロールモード制御: SLSH_SCRL優先、次にL1
     if (!is_slash_scroll_active) {
-        keyball_set_scroll_mode(layer_state_cmp(state, 1));
+        scroll_set_mode(layer_state_cmp(state, 1));
     }
+
+    pointer_profile_apply(get_highest_layer(state));
     
     return state;
 }
 
 // ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
 // OLED表示設定
+// 
+// OLEDタスクは毎回呼ばれるが、表示の元になる値が変わった行だけ書き直す
+// - Key行:   キーイベントがあった時
+// - Ball行:  マウスレポート・CPI・スクロールスナップが変わった時
+// - Layer行: レイヤー・スクロールモードが変わった時
+// - 統計ページ: 件数が変わった時
+// 書かない行は前回の内容がOLEDのバッファにそのまま残る
+// (OLEDドライバは書き換わったブロックだけI2Cで送る)
 // ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
 #ifdef OLED_ENABLE
 #    include "lib/oledkit/oledkit.h"
 
+// keyball標準表示の行位置(keyinfo 1行 / ballinfo 2行 / layerinfo 1行)
+#    define OLED_ROW_KEYINFO 0
+#    define OLED_ROW_BALLINFO 1
+#    define OLED_ROW_LAYERINFO 3
+
+static uint8_t        oled_drawn_key_events;
+static report_mouse_t oled_drawn_ball;
+static uint8_t        oled_drawn_cpi;
+static uint8_t        oled_drawn_snap;
+static layer_state_t  oled_drawn_layer;
+static bool           oled_drawn_scroll;
+static uint16_t       oled_drawn_latency_count;
+static uint32_t       oled_drawn_prof_window;
+static uint16_t       oled_drawn_heat_events;
+static uint16_t       oled_drawn_split_state = 0xFFFF;  // 副側: 初回は必ず描く
+
+static void render_profile(void) {
+    oled_write_P(PSTR("Scan"), false);
+    oled_write(get_u16_str(prof_scan_rate, ' '), false);
+    oled_write_P(PSTR("/s"), false);
+    oled_write(get_u16_str(prof_loop_us, ' '), false);
+    oled_write_ln_P(PSTR("us"), false);
+    oled_write_P(PSTR("Sc"), false);
+    oled_write(get_u8_str(prof_share[PROF_SCAN], ' '), false);
+    oled_write_P(PSTR("% Rc"), false);
+    oled_write(get_u8_str(prof_share[PROF_RECORD], ' '), false);
+    oled_write_P(PSTR("% Sy"), false);
+    oled_write(get_u8_str(prof_share[PROF_SPLIT], ' '), false);
+    oled_write_ln_P(PSTR("%"), false);
+    oled_write_P(PSTR("Pt"), false);
+    oled_write(get_u8_str(prof_share[PROF_POINTER], ' '), false);
+    oled_write_P(PSTR("% OL"), false);
+    oled_write(get_u8_str(prof_share[PROF_OLED], ' '), false);
+    oled_write_ln_P(PSTR("%"), false);
+}
+
+static void render_boot(void) {
+    oled_write_P(PSTR("Boot scan"), false);
+    oled_write(get_u16_str(boot_first_scan_ms, ' '), false);
+    oled_write_ln_P(PSTR("ms"), false);
+    oled_write_P(PSTR("     key "), false);
+    oled_write(get_u16_str(boot_first_key_ms, ' '), false);
+    oled_write_ln_P(PSTR("ms"), false);
+    oled_write_P(PSTR("     ptr "), false);
+    oled_write(get_u16_str(boot_first_pointer_ms, ' '), false);
+    oled_write_ln_P(PSTR("ms"), false);
+}
+
+static void render_latency_ms(uint16_t ms) {
+    oled_write(get_u16_str(ms, ' '), false);
+    oled_write_ln_P(ms == KEYLAT_OPEN_MS ? PSTR("+ms") : PSTR("ms"), false);
+}
+
+static void render_latency(void) {
+    oled_write_P(PSTR("Lat p50:"), false);
+    render_latency_ms(keylat_percentile(50));
+    oled_write_P(PSTR("    p99:"), false);
+    render_latency_ms(keylat_percentile(99));
+    oled_write_P(PSTR("      n:"), false);
+    oled_write_ln(get_u16_str(keylat_count, ' '), false);
+}
+
+static void render_heat(void) {
+    uint32_t total = heat_total();
+    oled_write_P(PSTR("Heat km"), false);
+    oled_write(get_u8_str(heat.profile, ' '), false);
+    oled_write_P(PSTR(" n"), false);
+    oled_write_ln(get_u16_str(MIN(total, UINT16_MAX), ' '), false);
+    oled_write_P(PSTR("Lyr%"), false);
+    for (uint8_t i = 0; i < HEAT_LAYERS; i++) {
+        oled_write(get_u8_str(total ? (uint32_t)heat.layer[i] * 100 / total : 0, ' '), false);
+    }
+    oled_advance_page(true);
+    // 一番多い同じ手のバイグラム(位置の番号)
+    uint8_t top = 0;
+    for (uint8_t i = 1; i < HEAT_BIGRAMS; i++) {
+        if (heat.bigram[i].count > heat.bigram[top].count) {
+            top = i;
+        }
+    }
+    oled_write_P(PSTR("Bi"), false);
+    oled_write(get_u8_str(heat.bigram[top].from, ' '), false);
+    oled_write_P(PSTR(">"), false);
+    oled_write(get_u8_str(heat.bigram[top].to, ' '), false);
+    oled_write_ln(get_u16_str(heat.bigram[top].count, ' '), false);
+}
+
+static void render_info(void) {
+    bool all        = oled_redraw_all;
+    oled_redraw_all = false;
+
+    if (all || oled_key_events != oled_drawn_key_events) {
+        oled_drawn_key_events = oled_key_events;
+        oled_set_cursor(0, OLED_ROW_KEYINFO);
+        keyball_oled_render_keyinfo();
+    }
+
+    switch (stat_page) {
+        case STAT_PAGE_LATENCY:
+            if (all || keylat_count != oled_drawn_latency_count) {
+                oled_drawn_latency_count = keylat_count;
+                oled_set_cursor(0, OLED_ROW_BALLINFO);
+                render_latency();
+            }
+            break;
+        case STAT_PAGE_BOOT:
+            if (all) {  // 一度決まったら変わらない(切替時に描く)
+                oled_set_cursor(0, OLED_ROW_BALLINFO);
+                render_boot();
+            }
+            break;
+        case STAT_PAGE_HEAT:
+            if (all || heat_events != oled_drawn_heat_events) {
+                oled_drawn_heat_events = heat_events;
+                oled_set_cursor(0, OLED_ROW_BALLINFO);
+                render_heat();
+            }
+            break;
+        case STAT_PAGE_PROFILE:
+            if (all || prof_window_start != oled_drawn_prof_window) {  // 1秒ごとに更新される
+                oled_drawn_prof_window = prof_window_start;
+                oled_set_cursor(0, OLED_ROW_BALLINFO);
+                render_profile();
+            }
+            break;
+        default:
+            if (all || memcmp(&oled_ball_seen, &oled_drawn_ball, sizeof(oled_drawn_ball)) != 0 || keyball_get_cpi() != oled_drawn_cpi || keyball_get_scrollsnap_mode() != oled_drawn_snap) {
+                oled_drawn_ball = oled_ball_seen;
+                oled_drawn_cpi  = keyball_get_cpi();
+                oled_drawn_snap = keyball_get_scrollsnap_mode();
+                oled_set_cursor(0, OLED_ROW_BALLINFO);
+                keyball_oled_render_ballinfo();
+            }
+            if (all || layer_state != oled_drawn_layer || keyball_get_scroll_mode() != oled_drawn_scroll) {
+                oled_drawn_layer  = layer_state;
+                oled_drawn_scroll = keyball_get_scroll_mode();
+                oled_set_cursor(0, OLED_ROW_LAYERINFO);
+                keyball_oled_render_layerinfo();
+            }
+            break;
+    }
+}
+
 void oledkit_render_info_user(void) {
-    keyball_oled_render_keyinfo();
-    keyball_oled_render_ballinfo();
-    keyball_oled_render_layerinfo();
+    if (!boot_oled_ready) {
+        return;  // 起動直後はキー処理を優先(起動時間の計測参照)
+    }
+    uint32_t start = prof_now();
+    render_info();
+    prof_add(PROF_OLED, start);
+}
+
+// 副側: マスターから受け取った状態を表示(変わった時だけ描く)
+void oledkit_render_logo_user(void) {
+    if (!boot_oled_ready || split_state_received == oled_drawn_split_state) {
+        return;
+    }
+    oled_drawn_split_state = split_state_received;
+    uint8_t state          = split_state_received;
+
+    oled_set_cursor(0, 0);
+    oled_write_ln_P((state & SPLIT_STATE_IME) ? PSTR("IME  Kana") : PSTR("IME  Eisu"), false);
+    oled_write_P((state & SPLIT_STATE_MAC) ? PSTR("Host Mac") : PSTR("Host Win"), false);
+    oled_write_ln_P((state >> SPLIT_STATE_OVERRIDE_SHIFT) != HOST_AUTO ? PSTR(" (fixed)") : PSTR(""), false);
+    oled_write_ln_P((state & SPLIT_STATE_SCROLL) ? PSTR("Scroll") : PSTR(""), false);
+    oled_write_ln_P((state & SPLIT_STATE_APP_SW) ? PSTR("AppSw") : PSTR(""), false);
 }
-#kj
+#endif
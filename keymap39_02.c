@@ -16,7 +16,7 @@
  * Layer 1中段：[ ] ( ) { }
  * 
  * 【コンボ】
- * D+F → 英数⇔かなトグル
+ * D+F → 英数⇔かなトグル（COMBO_ENABLE = yes の時、keymap.c に内蔵した配列では常に有効）
  */
 
 #include QMK_KEYBOARD_H
@@ -59,7 +59,7 @@ static bool is_kana_mode = false;
 #define UNDER    KC_UNDS      // _
 #define QUOTE    KC_QUOT      // '
 #define DQUOTE   KC_DQUO      // "
-#define BACKSLS  KC_BSLS      // \
+#define BACKSLS  KC_BSLS      // \（行末に置くと次の行までコメントになる）
 #define PIPE     KC_PIPE      // |
 #define GRAVE    KC_GRV       // `
 #define TILDE    KC_TILD      // ~
@@ -75,8 +75,13 @@ static bool is_kana_mode = false;
 #define XXX      XXXXXXX      // 無効
 
 // ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
-// コンボ定義
+// コンボ定義（QMKのコンボ）
+// 
+// keymap.c は自前のコンボエンジンを使うため COMBO_ENABLE = no でビルドする
+// その設定ではQMKのコンボは無いので、ここも外す
+// （D+F は keymap.c に内蔵したこの配列（キーマップ切替）のコンボで使える）
 // ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+#ifdef COMBO_ENABLE
 enum combos {
     DF_LANG,     // D+F → 言語トグル
     COMBO_LENGTH
@@ -88,6 +93,7 @@ const uint16_t PROGMEM df_combo[] = {KC_D, KC_F, COMBO_END};
 combo_t key_combos[] = {
     [DF_LANG]    = COMBO(df_combo, LANG_TOG),
 };
+#endif
 
 // ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
 // カスタムキー処理
@@ -232,6 +238,39 @@ const uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS] = {
 };
 // clang-format on
 
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// 左右同期（かな/英数・スクロールモード）
+// 
+// 状態はUSB側（マスター）にしかないので、1バイトにまとめて副側へ送る
+// - 送るのは値が変わった時だけ、失敗したら次のループで再送
+// - 副側は受け取った値をOLEDに表示
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+#define SPLIT_STATE_KANA   (1 << 0)  // かな
+#define SPLIT_STATE_SCROLL (1 << 2)  // スクロールモード（keymap.c と同じビット）
+#define SPLIT_STATE_NONE   0xFF      // 未送信
+
+static uint8_t split_state_sent     = SPLIT_STATE_NONE;  // マスター：最後に送れた値
+static uint8_t split_state_received = 0;                 // 副側：受け取った値
+
+static void split_state_receive(uint8_t in_buflen, const void *in_data, uint8_t out_buflen, void *out_data) {
+    if (in_buflen == sizeof(split_state_received)) {
+        split_state_received = *(const uint8_t *)in_data;
+    }
+}
+
+void housekeeping_task_user(void) {
+    if (is_keyboard_master()) {
+        uint8_t state = (is_kana_mode ? SPLIT_STATE_KANA : 0) | (keyball_get_scroll_mode() ? SPLIT_STATE_SCROLL : 0);
+        if (state != split_state_sent && transaction_rpc_send(USER_SYNC_STATE, sizeof(state), &state)) {
+            split_state_sent = state;
+        }
+    }
+}
+
+void keyboard_post_init_user(void) {
+    transaction_register_rpc(USER_SYNC_STATE, split_state_receive);
+}
+
 // ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
 // レイヤー状態管理
 // ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
@@ -240,6 +279,34 @@ layer_state_t layer_state_set_user(layer_state_t state) {
     return state;
 }
 
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// ホイール
+// 
+// config.h で高解像度スクロールが有効（keymap.c 用）なので、
+// ホストが解像度を上げるとkeyballの1ノッチが1/解像度になる
+// この配列ではノッチ単位のまま使うので、解像度を掛けて送る
+// 1レポート（±127）に入りきらない分は捨てずに次のレポートで送る
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+#ifdef POINTING_DEVICE_HIRES_SCROLL_ENABLE
+static int32_t wheel_carry_h;  // 単位：ノッチ × 解像度
+static int32_t wheel_carry_v;
+
+static int8_t wheel_take(int32_t *carry) {
+    int8_t out = MIN(MAX(*carry, -127), 127);
+    *carry -= out;
+    return out;
+}
+
+report_mouse_t pointing_device_task_user(report_mouse_t report) {
+    int16_t res = pointing_device_get_hires_scroll_resolution();
+    wheel_carry_h += report.h * res;
+    wheel_carry_v += report.v * res;
+    report.h = wheel_take(&wheel_carry_h);
+    report.v = wheel_take(&wheel_carry_v);
+    return report;
+}
+#endif
+
 // ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
 // OLED表示設定
 // ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
@@ -251,4 +318,18 @@ void oledkit_render_info_user(void) {
     keyball_oled_render_ballinfo();
     keyball_oled_render_layerinfo();
 }
+
+// 副側：マスターから受け取った状態を表示（変わった時だけ描く）
+static uint16_t oled_drawn_split_state = 0xFFFF;
+
+void oledkit_render_logo_user(void) {
+    if (split_state_received == oled_drawn_split_state) {
+        return;
+    }
+    oled_drawn_split_state = split_state_received;
+
+    oled_set_cursor(0, 0);
+    oled_write_ln_P((split_state_received & SPLIT_STATE_KANA) ? PSTR("IME  Kana") : PSTR("IME  Eisu"), false);
+    oled_write_ln_P((split_state_received & SPLIT_STATE_SCROLL) ? PSTR("Scroll") : PSTR(""), false);
+}
 #endif
\ No newline at end of file
@@ -0,0 +1,16 @@
+# ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+# キーマップ共通のQMK機能
+#
+# keymap.c / keymap39_02.c のどちらでビルドしても読まれる
+# (OLED・トラックボールはキーボード側の rules.mk で有効)
+# ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+
+# コンボは keymap.c の索引付きエンジンで処理するので、QMKのコンボは使わない
+# (有効だと keymap.c に key_combos が無くてビルドできない)
+COMBO_ENABLE = no
+
+# keymap.c のコンボ待ち・カスタムTap-Hold・慣性スクロール等は defer_exec で動かす
+DEFERRED_EXEC_ENABLE = yes
+
+# OS判定(Mac/Win で IME キー・ショートカットを切り替える)
+OS_DETECTION_ENABLE = yes
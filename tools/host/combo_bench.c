@@ -0,0 +1,131 @@
+/*
+ * コンボエンジンの計測(コンボの数を変えても1イベントのコストが一定か)
+ *
+ * keymap.c のコンボ(5個)に USER_COMBOS_EXTRA で英字2キーのコンボを足し、
+ * 合計 COMBO_BENCH_COUNT 個にして combo_process に押下を流す
+ *   candidate:    コンボに入るキー(保留して次のキーを待つ)
+ *   pass-through: コンボに入らないキー(そのまま通す)
+ * 比較用に、押下ごとに全コンボを走査する場合(索引なし)のコストも出す
+ *
+ * 【ビルド・実行】(リポジトリのルートで、数ごとにビルドし直す)
+ *   for n in 5 8 16 32 64; do
+ *     cc -std=gnu11 -O2 -Wall -Itools/host/include -include config.h -DQMK_KEYBOARD_H='"keyball39.h"' \
+ *        -DCOMBO_BENCH_COUNT=$n -o combo_bench tools/host/combo_bench.c tools/host/sim.c && ./combo_bench
+ *   done
+ */
+#include <stdint.h>
+
+#ifndef COMBO_BENCH_COUNT
+#    define COMBO_BENCH_COUNT 64
+#endif
+
+// 足すコンボ: 英字2キー(2キーは必ず別の文字)、出力は F1〜F12
+#define BENCH_COMBO(i) {{KC_A + (i) % 26, KC_A + ((i)*7 + 11) % 26}, KC_F1 + (i) % 12, KM_MAIN},
+#define BENCH_COMBO4(i) BENCH_COMBO(i) BENCH_COMBO(i + 1) BENCH_COMBO(i + 2) BENCH_COMBO(i + 3)
+#define BENCH_COMBO8(i) BENCH_COMBO4(i) BENCH_COMBO4(i + 4)
+#define BENCH_COMBO16(i) BENCH_COMBO8(i) BENCH_COMBO8(i + 8)
+#define BENCH_COMBO32(i) BENCH_COMBO16(i) BENCH_COMBO16(i + 16)
+
+// keymap.c の5個に足して 8 / 16 / 32 / 64 個
+#if COMBO_BENCH_COUNT == 5
+#    define USER_COMBOS_EXTRA
+#    define COMBO_MASK_T uint8_t
+#elif COMBO_BENCH_COUNT == 8
+#    define USER_COMBOS_EXTRA BENCH_COMBO(0) BENCH_COMBO(1) BENCH_COMBO(2)
+#    define COMBO_MASK_T uint8_t
+#elif COMBO_BENCH_COUNT == 16
+#    define USER_COMBOS_EXTRA BENCH_COMBO8(0) BENCH_COMBO(8) BENCH_COMBO(9) BENCH_COMBO(10)
+#    define COMBO_MASK_T uint16_t
+#elif COMBO_BENCH_COUNT == 32
+#    define USER_COMBOS_EXTRA BENCH_COMBO16(0) BENCH_COMBO8(16) BENCH_COMBO(24) BENCH_COMBO(25) BENCH_COMBO(26)
+#    define COMBO_MASK_T uint32_t
+#elif COMBO_BENCH_COUNT == 64
+#    define USER_COMBOS_EXTRA BENCH_COMBO32(0) BENCH_COMBO16(32) BENCH_COMBO8(48) BENCH_COMBO(56) BENCH_COMBO(57) BENCH_COMBO(58)
+#    define COMBO_MASK_T uint64_t
+#else
+#    error "COMBO_BENCH_COUNT must be 5, 8, 16, 32 or 64"
+#endif
+
+#include "../../keymap.c"
+#include "sim.h"
+
+_Static_assert(USER_COMBO_COUNT == COMBO_BENCH_COUNT, "USER_COMBOS_EXTRA does not add up to COMBO_BENCH_COUNT");
+
+// 索引なしの場合: 押下ごとに全コンボのキーと比べる
+static volatile uint32_t linear_sink;
+
+static void linear_scan(uint16_t keycode) {
+    uint32_t hits = 0;
+    for (uint8_t i = 0; i < USER_COMBO_COUNT; i++) {
+        if (!(pgm_read_byte(&user_combos[i].keymaps) & (1 << user_config.keymap_profile))) {
+            continue;
+        }
+        if (pgm_read_word(&user_combos[i].keys[0]) == keycode || pgm_read_word(&user_combos[i].keys[1]) == keycode) {
+            hits |= 1u << (i & 31);
+        }
+    }
+    linear_sink = hits;
+}
+
+// コンボ判定だけ(押下1回分、保留になったらその場で取り消す)
+static void combo_press(keypos_t pos) {
+    keyrecord_t record = {.event = {.key = pos, .time = timer_read(), .type = KEY_EVENT, .pressed = true}};
+    if (!combo_process(&record) && combo_pending_mask) {
+        combo_pending_mask = 0;
+        cancel_deferred_exec(combo_token);
+        combo_token = INVALID_DEFERRED_TOKEN;
+    }
+}
+
+#define REPEAT 10000
+
+// keys[] の押下をコンボ判定だけ REPEAT 回流し、1押下あたりのサイクル数を返す
+// (割り込み等の外れ値を避けて5回の最小値)
+static double bench_combo(const uint16_t *keys, uint8_t n) {
+    keypos_t pos[8];
+    for (uint8_t i = 0; i < n; i++) {
+        pos[i] = sim_at(keys[i], 0);
+    }
+    uint64_t best = UINT64_MAX;
+    for (uint8_t trial = 0; trial < 5; trial++) {
+        uint64_t start = sim_cycles();
+        for (uint16_t round = 0; round < REPEAT; round++) {
+            for (uint8_t i = 0; i < n; i++) {
+                combo_press(pos[i]);
+            }
+        }
+        best = MIN(best, sim_cycles() - start);
+    }
+    return (double)best / REPEAT / n;
+}
+
+// 同じ押下を索引なしで判定した場合
+static double bench_linear(const uint16_t *keys, uint8_t n) {
+    uint64_t best = UINT64_MAX;
+    for (uint8_t trial = 0; trial < 5; trial++) {
+        uint64_t start = sim_cycles();
+        for (uint16_t round = 0; round < REPEAT; round++) {
+            for (uint8_t i = 0; i < n; i++) {
+                linear_scan(keys[i]);
+            }
+        }
+        best = MIN(best, sim_cycles() - start);
+    }
+    return (double)best / REPEAT / n;
+}
+
+int main(void) {
+    // どのビルドでもコンボに入るキー(保留になる) / 入らないキー(そのまま通す)
+    static const uint16_t candidate[] = {KC_F, KC_G, KC_J, KC_K};
+    static const uint16_t through[]   = {KC_COMM, KC_DOT, KC_ENT, KC_LALT};
+
+    sim_eeprom_erase();
+    sim_init(OS_MACOS);
+    sim_advance(2000);
+
+    double cand = bench_combo(candidate, 4);
+    double pass = bench_combo(through, 4);
+    double lin  = bench_linear(candidate, 4);
+    printf("combos %2u  combo_process cycles/press: candidate %5.1f  pass-through %5.1f  (linear scan %6.1f)\n", (unsigned)USER_COMBO_COUNT, cand, pass, lin);
+    return 0;
+}
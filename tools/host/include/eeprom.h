@@ -0,0 +1,4 @@
+// EEPROM(ホストシミュレータ用、関数は quantum.h で宣言)
+#pragma once
+
+#include "quantum.h"
@@ -0,0 +1,4 @@
+// QMK_KEYBOARD_H(ホストシミュレータ用)
+#pragma once
+
+#include "quantum.h"
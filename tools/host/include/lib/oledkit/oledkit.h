@@ -0,0 +1,7 @@
+// keyball の oledkit(ホストシミュレータ用)
+#pragma once
+
+#include "quantum.h"
+
+void oledkit_render_info_user(void);
+void oledkit_render_logo_user(void);
@@ -0,0 +1,15 @@
+// ホストOS判定(ホストシミュレータ用、sim_set_os で切り替える)
+#pragma once
+
+#include "quantum.h"
+
+typedef enum {
+    OS_UNSURE,
+    OS_LINUX,
+    OS_WINDOWS,
+    OS_MACOS,
+    OS_IOS,
+} os_variant_t;
+
+os_variant_t detected_host_os(void);
+bool         process_detected_host_os_user(os_variant_t detected_os);
@@ -0,0 +1,477 @@
+/*
+ * ホストシミュレータ用のQMKスタブ(keymap.c / keymap39_02.c が使う分だけ)
+ *
+ * キーコードの値・LAYOUT_right_ball のマトリクス配置は本物のQMK / keyball39.h に合わせる
+ * 関数の実体は tools/host/sim.c
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// progmem
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+#define PROGMEM
+#define PSTR(s) s
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+#define memcpy_P(d, s, n) memcpy((d), (s), (n))
+
+#ifndef MIN
+#    define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+#    define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// マトリクス・キーイベント
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+#define MATRIX_ROWS 8
+#define MATRIX_COLS 6
+
+typedef struct {
+    uint8_t col;
+    uint8_t row;
+} keypos_t;
+
+typedef enum {
+    TICK_EVENT  = 0,
+    KEY_EVENT   = 1,
+    COMBO_EVENT = 2,
+} keyevent_type_t;
+
+typedef struct {
+    keypos_t        key;
+    uint16_t        time;
+    keyevent_type_t type;
+    bool            pressed;
+} keyevent_t;
+
+typedef struct {
+    bool    interrupted : 1;
+    bool    reserved2 : 1;
+    bool    reserved1 : 1;
+    bool    reserved0 : 1;
+    uint8_t count : 4;
+} tap_t;
+
+typedef struct {
+    keyevent_t event;
+    tap_t      tap;
+    uint16_t   keycode;
+} keyrecord_t;
+
+static inline bool IS_KEYEVENT(keyevent_t event) {
+    return event.type == KEY_EVENT;
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// キーコード
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+enum qk_keycodes {
+    KC_NO   = 0x0000,
+    KC_TRNS = 0x0001,
+    KC_A    = 0x0004,
+    KC_B,
+    KC_C,
+    KC_D,
+    KC_E,
+    KC_F,
+    KC_G,
+    KC_H,
+    KC_I,
+    KC_J,
+    KC_K,
+    KC_L,
+    KC_M,
+    KC_N,
+    KC_O,
+    KC_P,
+    KC_Q,
+    KC_R,
+    KC_S,
+    KC_T,
+    KC_U,
+    KC_V,
+    KC_W,
+    KC_X,
+    KC_Y,
+    KC_Z,
+    KC_1,
+    KC_2,
+    KC_3,
+    KC_4,
+    KC_5,
+    KC_6,
+    KC_7,
+    KC_8,
+    KC_9,
+    KC_0,
+    KC_ENT,
+    KC_ESC,
+    KC_BSPC,
+    KC_TAB,
+    KC_SPC,
+    KC_MINS,
+    KC_EQL,
+    KC_LBRC,
+    KC_RBRC,
+    KC_BSLS,
+    KC_NUHS,
+    KC_SCLN,
+    KC_QUOT,
+    KC_GRV,
+    KC_COMM,
+    KC_DOT,
+    KC_SLSH,
+    KC_CAPS,
+    KC_F1,
+    KC_F2,
+    KC_F3,
+    KC_F4,
+    KC_F5,
+    KC_F6,
+    KC_F7,
+    KC_F8,
+    KC_F9,
+    KC_F10,
+    KC_F11,
+    KC_F12,
+    KC_HOME = 0x004A,
+    KC_PGUP,
+    KC_DEL,
+    KC_END,
+    KC_PGDN,
+    KC_RGHT,
+    KC_LEFT,
+    KC_DOWN,
+    KC_UP,
+    KC_INT1 = 0x0087,
+    KC_INT2,
+    KC_INT3,
+    KC_INT4,
+    KC_INT5,
+    KC_LNG1 = 0x0090,
+    KC_LNG2,
+    KC_BTN1 = 0x00D1,
+    KC_BTN2,
+    KC_BTN3,
+    KC_BTN4,
+    KC_BTN5,
+    KC_LCTL = 0x00E0,
+    KC_LSFT,
+    KC_LALT,
+    KC_LGUI,
+    KC_RCTL,
+    KC_RSFT,
+    KC_RALT,
+    KC_RGUI,
+
+    QK_MODS             = 0x0100,
+    QK_MODS_MAX         = 0x1FFF,
+    QK_MOD_TAP          = 0x2000,
+    QK_MOD_TAP_MAX      = 0x3FFF,
+    QK_LAYER_TAP        = 0x4000,
+    QK_LAYER_TAP_MAX    = 0x4FFF,
+    QK_MOMENTARY        = 0x5220,
+    QK_MOMENTARY_MAX    = 0x523F,
+    QK_BOOT             = 0x7C00,
+    QK_KB_0             = 0x7E00,
+    QK_USER             = 0x7E40,
+};
+
+#define _______ KC_TRNS
+#define XXXXXXX KC_NO
+#define SAFE_RANGE QK_USER
+
+#define IS_BASIC_KEYCODE(kc) ((kc) >= KC_A && (kc) <= 0x00A4)
+#define IS_MODIFIER_KEYCODE(kc) ((kc) >= KC_LCTL && (kc) <= KC_RGUI)
+#define IS_MOUSEKEY_BUTTON(kc) ((kc) >= KC_BTN1 && (kc) <= 0x00D8)
+#define IS_QK_MODS(kc) ((kc) >= QK_MODS && (kc) <= QK_MODS_MAX)
+#define IS_QK_MOD_TAP(kc) ((kc) >= QK_MOD_TAP && (kc) <= QK_MOD_TAP_MAX)
+#define IS_QK_LAYER_TAP(kc) ((kc) >= QK_LAYER_TAP && (kc) <= QK_LAYER_TAP_MAX)
+#define IS_QK_MOMENTARY(kc) ((kc) >= QK_MOMENTARY && (kc) <= QK_MOMENTARY_MAX)
+
+// 修飾(5bit: 0x10 が右手)
+#define MOD_LCTL 0x01
+#define MOD_LSFT 0x02
+#define MOD_LALT 0x04
+#define MOD_LGUI 0x08
+#define MOD_RCTL 0x11
+#define MOD_RSFT 0x12
+#define MOD_RALT 0x14
+#define MOD_RGUI 0x18
+#define MOD_BIT(code) (1 << ((code)&0x07))
+
+#define QK_LCTL 0x0100
+#define QK_LSFT 0x0200
+#define QK_LALT 0x0400
+#define QK_LGUI 0x0800
+#define QK_RMODS_MIN 0x1000
+#define QK_MODS_GET_MODS(kc) (((kc) >> 8) & 0x1F)
+#define QK_MODS_GET_BASIC_KEYCODE(kc) ((kc)&0xFF)
+#define LCTL(kc) (QK_LCTL | (kc))
+#define LSFT(kc) (QK_LSFT | (kc))
+#define LALT(kc) (QK_LALT | (kc))
+#define LGUI(kc) (QK_LGUI | (kc))
+#define C(kc) LCTL(kc)
+#define S(kc) LSFT(kc)
+#define A(kc) LALT(kc)
+#define G(kc) LGUI(kc)
+
+#define MT(mod, kc) (QK_MOD_TAP | (((mod)&0x1F) << 8) | ((kc)&0xFF))
+#define LCTL_T(kc) MT(MOD_LCTL, kc)
+#define LSFT_T(kc) MT(MOD_LSFT, kc)
+#define LALT_T(kc) MT(MOD_LALT, kc)
+#define LGUI_T(kc) MT(MOD_LGUI, kc)
+#define CTL_T(kc) LCTL_T(kc)
+#define SFT_T(kc) LSFT_T(kc)
+#define ALT_T(kc) LALT_T(kc)
+#define GUI_T(kc) LGUI_T(kc)
+#define QK_MOD_TAP_GET_MODS(kc) (((kc) >> 8) & 0x1F)
+#define QK_MOD_TAP_GET_TAP_KEYCODE(kc) ((kc)&0xFF)
+
+#define LT(layer, kc) (QK_LAYER_TAP | (((layer)&0xF) << 8) | ((kc)&0xFF))
+#define QK_LAYER_TAP_GET_LAYER(kc) (((kc) >> 8) & 0xF)
+#define QK_LAYER_TAP_GET_TAP_KEYCODE(kc) ((kc)&0xFF)
+#define MO(layer) (QK_MOMENTARY | ((layer)&0x1F))
+#define QK_MOMENTARY_GET_LAYER(kc) ((kc)&0x1F)
+
+#define KC_TILD S(KC_GRV)
+#define KC_EXLM S(KC_1)
+#define KC_AT S(KC_2)
+#define KC_HASH S(KC_3)
+#define KC_DLR S(KC_4)
+#define KC_PERC S(KC_5)
+#define KC_CIRC S(KC_6)
+#define KC_AMPR S(KC_7)
+#define KC_ASTR S(KC_8)
+#define KC_LPRN S(KC_9)
+#define KC_RPRN S(KC_0)
+#define KC_UNDS S(KC_MINS)
+#define KC_PLUS S(KC_EQL)
+#define KC_LCBR S(KC_LBRC)
+#define KC_RCBR S(KC_RBRC)
+#define KC_PIPE S(KC_BSLS)
+#define KC_COLN S(KC_SCLN)
+#define KC_DQUO S(KC_QUOT)
+#define KC_LABK S(KC_COMM)
+#define KC_RABK S(KC_DOT)
+#define KC_QUES S(KC_SLSH)
+
+// keyball のキーコード(keyball.h と同じ順)
+enum keyball_keycodes {
+    KBC_RST = QK_KB_0,
+    KBC_SAVE,
+    CPI_I100,
+    CPI_D100,
+    CPI_I1K,
+    CPI_D1K,
+    SCRL_TO,
+    SCRL_MO,
+    SCRL_DVI,
+    SCRL_DVD,
+    SSNP_VRT,
+    SSNP_HOR,
+    SSNP_FRE,
+};
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// keyball39.h: LAYOUT_right_ball
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// clang-format off
+#define LAYOUT_right_ball( \
+    L00, L01, L02, L03, L04,           R04, R03, R02, R01, R00, \
+    L10, L11, L12, L13, L14,           R14, R13, R12, R11, R10, \
+    L20, L21, L22, L23, L24,           R24, R23, R22, R21, R20, \
+    L30, L31, L32, L33, L34, L35, R35, R34,                R30  \
+) { \
+    { L00, L01, L02, L03, L04, KC_NO }, \
+    { L10, L11, L12, L13, L14, KC_NO }, \
+    { L20, L21, L22, L23, L24, KC_NO }, \
+    { L30, L31, L32, L33, L34, L35   }, \
+    { R00, R01, R02, R03, R04, KC_NO }, \
+    { R10, R11, R12, R13, R14, KC_NO }, \
+    { R20, R21, R22, R23, R24, KC_NO }, \
+    { R30, KC_NO, KC_NO, KC_NO, R34, R35 }, \
+}
+// clang-format on
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// アクション・キー送信
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+typedef union {
+    uint16_t code;  // シミュレータではキーコードをそのまま持つ
+} action_t;
+
+action_t action_for_keycode(uint16_t keycode);
+void     process_action(keyrecord_t *record, action_t action);
+void     action_tapping_process(keyrecord_t record);
+uint16_t keymap_key_to_keycode(uint8_t layer, keypos_t key);
+void     clear_keyboard(void);
+
+#define TAP_CODE_DELAY 0
+
+void    register_code(uint8_t code);
+void    unregister_code(uint8_t code);
+void    tap_code(uint8_t code);
+void    register_code16(uint16_t code);
+void    unregister_code16(uint16_t code);
+void    tap_code16(uint16_t code);
+void    add_key(uint8_t key);
+void    del_key(uint8_t key);
+uint8_t get_mods(void);
+void    add_mods(uint8_t mods);
+void    del_mods(uint8_t mods);
+uint8_t get_weak_mods(void);
+void    set_weak_mods(uint8_t mods);
+void    add_weak_mods(uint8_t mods);
+void    del_weak_mods(uint8_t mods);
+void    send_keyboard_report(void);
+void    wait_ms(uint16_t ms);
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// ユーザーフック(sim.c に何もしない既定あり)
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+typedef uint32_t layer_state_t;
+
+bool          pre_process_record_user(uint16_t keycode, keyrecord_t *record);
+bool          process_record_user(uint16_t keycode, keyrecord_t *record);
+void          post_process_record_user(uint16_t keycode, keyrecord_t *record);
+layer_state_t layer_state_set_user(layer_state_t state);
+void          keyboard_post_init_user(void);
+void          matrix_scan_user(void);
+void          housekeeping_task_user(void);
+void          eeconfig_init_user(void);
+bool          shutdown_user(bool jump_to_bootloader);
+uint16_t      get_tapping_term(uint16_t keycode, keyrecord_t *record);
+uint16_t      keycode_at_keymap_location(uint8_t layer_num, uint8_t row, uint8_t column);
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// レイヤー
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+extern layer_state_t layer_state;
+
+uint8_t get_highest_layer(layer_state_t state);
+bool    layer_state_cmp(layer_state_t state, uint8_t layer);
+bool    layer_state_is(uint8_t layer);
+void    layer_state_set(layer_state_t state);
+void    layer_on(uint8_t layer);
+void    layer_off(uint8_t layer);
+void    layer_clear(void);
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// タイマー・deferred executor
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+#define TIMER_DIFF_16(a, b) ((uint16_t)((a) - (b)))
+#define TIMER_DIFF_32(a, b) ((uint32_t)((a) - (b)))
+
+uint16_t timer_read(void);
+uint32_t timer_read32(void);
+uint16_t timer_elapsed(uint16_t last);
+uint32_t timer_elapsed32(uint32_t last);
+
+typedef uint8_t deferred_token;
+#define INVALID_DEFERRED_TOKEN 0
+typedef uint32_t (*deferred_exec_callback)(uint32_t trigger_time, void *cb_arg);
+
+deferred_token defer_exec(uint32_t delay_ms, deferred_exec_callback callback, void *cb_arg);
+bool           extend_deferred_exec(deferred_token token, uint32_t delay_ms);
+bool           cancel_deferred_exec(deferred_token token);
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// EEPROM(TOTAL_EEPROM_BYTE_COUNT バイトの配列、書き込みバイト数を数える)
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+#define TOTAL_EEPROM_BYTE_COUNT 1024
+
+void eeconfig_read_user_datablock(void *data);
+void eeconfig_update_user_datablock(const void *data);
+void eeprom_read_block(void *buf, const void *addr, size_t len);
+void eeprom_update_block(const void *buf, void *addr, size_t len);
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// ポインティングデバイス・keyball
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+typedef int8_t mouse_xy_report_t;
+typedef int8_t mouse_hv_report_t;
+#define XY_REPORT_MIN INT8_MIN
+#define XY_REPORT_MAX INT8_MAX
+
+typedef struct {
+    uint8_t           buttons;
+    mouse_xy_report_t x;
+    mouse_xy_report_t y;
+    mouse_hv_report_t v;
+    mouse_hv_report_t h;
+} report_mouse_t;
+
+report_mouse_t pointing_device_get_report(void);
+void           pointing_device_set_report(report_mouse_t report);
+bool           pointing_device_send(void);
+report_mouse_t pointing_device_task_user(report_mouse_t report);
+uint16_t       pointing_device_get_hires_scroll_resolution(void);
+
+typedef struct {
+    int16_t x;
+    int16_t y;
+} keyball_motion_t;
+
+typedef enum {
+    KEYBALL_SCROLLSNAP_MODE_VERTICAL   = 0,
+    KEYBALL_SCROLLSNAP_MODE_HORIZONTAL = 1,
+    KEYBALL_SCROLLSNAP_MODE_FREE       = 2,
+} keyball_scrollsnap_mode_t;
+
+uint8_t                   keyball_get_cpi(void);
+void                      keyball_set_cpi(uint8_t cpi);
+uint8_t                   keyball_get_scroll_div(void);
+void                      keyball_set_scroll_div(uint8_t div);
+bool                      keyball_get_scroll_mode(void);
+void                      keyball_set_scroll_mode(bool mode);
+keyball_scrollsnap_mode_t keyball_get_scrollsnap_mode(void);
+void                      keyball_set_scrollsnap_mode(keyball_scrollsnap_mode_t mode);
+void                      keyball_on_apply_motion_to_mouse_move(keyball_motion_t *m, report_mouse_t *r, bool is_left);
+void                      keyball_on_apply_motion_to_mouse_scroll(keyball_motion_t *m, report_mouse_t *r, bool is_left);
+void                      keyball_oled_render_keyinfo(void);
+void                      keyball_oled_render_ballinfo(void);
+void                      keyball_oled_render_layerinfo(void);
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// 分割(マスターと副側は同じプロセス、RPCはその場で相手のハンドラを呼ぶ)
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+enum serial_transaction_id {
+#ifdef SPLIT_TRANSACTION_IDS_USER
+    SPLIT_TRANSACTION_IDS_USER,
+#endif
+    NUM_TOTAL_TRANSACTIONS,
+};
+
+typedef void (*slave_callback_t)(uint8_t in_buflen, const void *in_data, uint8_t out_buflen, void *out_data);
+
+bool is_keyboard_master(void);
+bool is_keyboard_left(void);
+void transaction_register_rpc(int8_t transaction_id, slave_callback_t callback);
+bool transaction_rpc_send(int8_t transaction_id, uint8_t initiator2target_buffer_size, const void *initiator2target_buffer);
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// OLED・コンソール(表示内容は捨てる)
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+void        oled_clear(void);
+void        oled_set_cursor(uint8_t col, uint8_t line);
+void        oled_write(const char *data, bool invert);
+void        oled_write_P(const char *data, bool invert);
+void        oled_write_ln(const char *data, bool invert);
+void        oled_write_ln_P(const char *data, bool invert);
+void        oled_write_char(char data, bool invert);
+void        oled_advance_page(bool clear_page);
+const char *get_u8_str(uint8_t value, char pad);
+const char *get_u16_str(uint16_t value, char pad);
+
+extern bool debug_enable;
+void        uprintf(const char *fmt, ...);
@@ -0,0 +1,950 @@
+/*
+ * キーマップのホストシミュレータ(QMK本体の代わり)
+ *
+ * 使い方・ビルドは sim.h
+ * キーマップが持たないフックには何もしない既定(weak)を置く
+ * Tap-Holdは QMK の既定を簡略化したもの(config.h の PERMISSIVE_HOLD は再現しない):
+ *   二役キーを押すと保留、他のイベントは保留中はバッファに溜める
+ *   get_tapping_term 内に離したらタップ、過ぎたらホールド
+ */
+#include "sim.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#    include <x86intrin.h>
+#endif
+#ifdef __linux__
+#    include <linux/perf_event.h>
+#    include <sys/ioctl.h>
+#    include <sys/syscall.h>
+#    include <unistd.h>
+#endif
+
+#define WEAK __attribute__((weak))
+
+#ifndef TAPPING_TERM
+#    define TAPPING_TERM 200  // QMKの既定
+#endif
+
+extern const uint16_t keymaps[][MATRIX_ROWS][MATRIX_COLS];
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// 時間
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+static uint32_t now_ms;
+
+uint32_t sim_now(void) {
+    return now_ms;
+}
+uint16_t timer_read(void) {
+    return (uint16_t)now_ms;
+}
+uint32_t timer_read32(void) {
+    return now_ms;
+}
+uint16_t timer_elapsed(uint16_t last) {
+    return TIMER_DIFF_16(timer_read(), last);
+}
+uint32_t timer_elapsed32(uint32_t last) {
+    return TIMER_DIFF_32(now_ms, last);
+}
+void wait_ms(uint16_t ms) {
+    (void)ms;  // 時間は sim_advance でしか進めない
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// deferred executor(QMKと同じく keyboard_task の中で呼ぶ)
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+#define DEFERRED_MAX 16
+
+typedef struct {
+    deferred_token         token;
+    uint32_t               due;
+    deferred_exec_callback callback;
+    void                  *cb_arg;
+} deferred_t;
+
+static deferred_t     deferred[DEFERRED_MAX];
+static deferred_token deferred_last;
+
+deferred_token defer_exec(uint32_t delay_ms, deferred_exec_callback callback, void *cb_arg) {
+    if (delay_ms == 0 || !callback) {
+        return INVALID_DEFERRED_TOKEN;
+    }
+    for (uint8_t i = 0; i < DEFERRED_MAX; i++) {
+        if (deferred[i].token == INVALID_DEFERRED_TOKEN) {
+            do {
+                deferred_last++;
+            } while (deferred_last == INVALID_DEFERRED_TOKEN);
+            deferred[i] = (deferred_t){deferred_last, now_ms + delay_ms, callback, cb_arg};
+            return deferred_last;
+        }
+    }
+    return INVALID_DEFERRED_TOKEN;
+}
+
+static deferred_t *deferred_find(deferred_token token) {
+    for (uint8_t i = 0; token != INVALID_DEFERRED_TOKEN && i < DEFERRED_MAX; i++) {
+        if (deferred[i].token == token) {
+            return &deferred[i];
+        }
+    }
+    return NULL;
+}
+
+bool extend_deferred_exec(deferred_token token, uint32_t delay_ms) {
+    deferred_t *d = deferred_find(token);
+    if (!d || delay_ms == 0) {
+        return false;
+    }
+    d->due = now_ms + delay_ms;
+    return true;
+}
+
+bool cancel_deferred_exec(deferred_token token) {
+    deferred_t *d = deferred_find(token);
+    if (!d) {
+        return false;
+    }
+    d->token = INVALID_DEFERRED_TOKEN;
+    return true;
+}
+
+static void deferred_task(void) {
+    for (uint8_t i = 0; i < DEFERRED_MAX; i++) {
+        deferred_t *d = &deferred[i];
+        if (d->token == INVALID_DEFERRED_TOKEN || TIMER_DIFF_32(now_ms, d->due) >= 0x80000000u) {
+            continue;
+        }
+        deferred_token token = d->token;
+        uint32_t       next  = d->callback(d->due, d->cb_arg);
+        if (d->token != token) {
+            continue;  // コールバックの中で取り消された
+        }
+        if (next == 0) {
+            d->token = INVALID_DEFERRED_TOKEN;
+        } else {
+            d->due += next;
+        }
+    }
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// HIDレポート
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+sim_keyboard_report_t sim_keyboard_reports[SIM_REPORTS_MAX];
+uint16_t              sim_keyboard_report_count;
+sim_mouse_report_t    sim_mouse_reports[SIM_REPORTS_MAX];
+uint16_t              sim_mouse_report_count;
+
+static uint8_t        real_mods;
+static uint8_t        weak_mods;
+static uint8_t        keys[6];
+static report_mouse_t mouse;
+static uint8_t        mouse_sent_buttons;
+
+void sim_reports_clear(void) {
+    sim_keyboard_report_count = 0;
+    sim_mouse_report_count    = 0;
+}
+
+void send_keyboard_report(void) {
+    sim_keyboard_report_t r = {.time = now_ms, .mods = real_mods | weak_mods};
+    memcpy(r.keys, keys, sizeof(keys));
+    if (sim_keyboard_report_count) {
+        const sim_keyboard_report_t *last = &sim_keyboard_reports[sim_keyboard_report_count - 1];
+        if (last->mods == r.mods && memcmp(last->keys, r.keys, sizeof(keys)) == 0) {
+            return;  // QMKも同じ内容は送り直さない
+        }
+    }
+    if (sim_keyboard_report_count < SIM_REPORTS_MAX) {
+        sim_keyboard_reports[sim_keyboard_report_count++] = r;
+    }
+}
+
+uint16_t sim_pressed_keys(uint8_t *out, uint8_t *out_mods, uint16_t max) {
+    uint16_t n        = 0;
+    uint8_t  prev[6]  = {0};
+    for (uint16_t i = 0; i < sim_keyboard_report_count && n < max; i++) {
+        const sim_keyboard_report_t *r = &sim_keyboard_reports[i];
+        for (uint8_t k = 0; k < 6 && n < max; k++) {
+            if (r->keys[k] && !memchr(prev, r->keys[k], sizeof(prev))) {
+                out[n] = r->keys[k];
+                if (out_mods) {
+                    out_mods[n] = r->mods;
+                }
+                n++;
+            }
+        }
+        memcpy(prev, r->keys, sizeof(prev));
+    }
+    return n;
+}
+
+void add_key(uint8_t key) {
+    if (memchr(keys, key, sizeof(keys))) {
+        return;
+    }
+    for (uint8_t i = 0; i < sizeof(keys); i++) {
+        if (!keys[i]) {
+            keys[i] = key;
+            return;
+        }
+    }
+}
+
+void del_key(uint8_t key) {
+    for (uint8_t i = 0; i < sizeof(keys); i++) {
+        if (keys[i] == key) {
+            keys[i] = 0;
+        }
+    }
+}
+
+uint8_t get_mods(void) {
+    return real_mods;
+}
+void add_mods(uint8_t mods) {
+    real_mods |= mods;
+}
+void del_mods(uint8_t mods) {
+    real_mods &= ~mods;
+}
+uint8_t get_weak_mods(void) {
+    return weak_mods;
+}
+void set_weak_mods(uint8_t mods) {
+    weak_mods = mods;
+}
+void add_weak_mods(uint8_t mods) {
+    weak_mods |= mods;
+}
+void del_weak_mods(uint8_t mods) {
+    weak_mods &= ~mods;
+}
+
+// 5bitの修飾(0x10 が右手)を8bitに
+static uint8_t mod_config_to_bits(uint8_t mods) {
+    return (mods & 0x10) ? (uint8_t)((mods & 0x0F) << 4) : (mods & 0x0F);
+}
+
+static void mouse_buttons(uint8_t code, bool pressed) {
+    uint8_t bit = 1 << (code - KC_BTN1);
+    mouse.buttons = pressed ? (mouse.buttons | bit) : (mouse.buttons & ~bit);
+    pointing_device_send();
+}
+
+void register_code(uint8_t code) {
+    if (IS_MODIFIER_KEYCODE(code)) {
+        add_mods(MOD_BIT(code));
+    } else if (IS_MOUSEKEY_BUTTON(code)) {
+        mouse_buttons(code, true);
+        return;
+    } else if (code != KC_NO) {
+        add_key(code);
+    }
+    send_keyboard_report();
+}
+
+void unregister_code(uint8_t code) {
+    if (IS_MODIFIER_KEYCODE(code)) {
+        del_mods(MOD_BIT(code));
+    } else if (IS_MOUSEKEY_BUTTON(code)) {
+        mouse_buttons(code, false);
+        return;
+    } else if (code != KC_NO) {
+        del_key(code);
+    }
+    send_keyboard_report();
+}
+
+void tap_code(uint8_t code) {
+    register_code(code);
+    wait_ms(TAP_CODE_DELAY);
+    unregister_code(code);
+}
+
+// QMKと同じく、修飾付きキーコードの修飾は弱い修飾で送る
+void register_code16(uint16_t code) {
+    uint8_t mods = mod_config_to_bits(QK_MODS_GET_MODS(code));
+    if (mods) {
+        if (IS_MODIFIER_KEYCODE(QK_MODS_GET_BASIC_KEYCODE(code)) || QK_MODS_GET_BASIC_KEYCODE(code) == KC_NO) {
+            add_mods(mods);
+        } else {
+            add_weak_mods(mods);
+        }
+        send_keyboard_report();
+    }
+    register_code(QK_MODS_GET_BASIC_KEYCODE(code));
+}
+
+void unregister_code16(uint16_t code) {
+    unregister_code(QK_MODS_GET_BASIC_KEYCODE(code));
+    uint8_t mods = mod_config_to_bits(QK_MODS_GET_MODS(code));
+    if (mods) {
+        if (IS_MODIFIER_KEYCODE(QK_MODS_GET_BASIC_KEYCODE(code)) || QK_MODS_GET_BASIC_KEYCODE(code) == KC_NO) {
+            del_mods(mods);
+        } else {
+            del_weak_mods(mods);
+        }
+        send_keyboard_report();
+    }
+}
+
+void tap_code16(uint16_t code) {
+    register_code16(code);
+    wait_ms(TAP_CODE_DELAY);
+    unregister_code16(code);
+}
+
+void clear_keyboard(void) {
+    real_mods = weak_mods = 0;
+    memset(keys, 0, sizeof(keys));
+    send_keyboard_report();
+    mouse.buttons = 0;
+    pointing_device_send();
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// ポインティングデバイス・keyball
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+#define KB_CPI_DEFAULT 5
+#define KB_SCROLL_DIV_DEFAULT 4
+
+static uint8_t                   kb_cpi       = KB_CPI_DEFAULT;
+static uint8_t                   kb_scroll_div = KB_SCROLL_DIV_DEFAULT;
+static bool                      kb_scroll_mode;
+static keyball_scrollsnap_mode_t kb_snap_mode = KEYBALL_SCROLLSNAP_MODE_VERTICAL;
+
+report_mouse_t pointing_device_get_report(void) {
+    return mouse;
+}
+void pointing_device_set_report(report_mouse_t report) {
+    mouse = report;
+}
+
+bool pointing_device_send(void) {
+    bool moved = mouse.x || mouse.y || mouse.h || mouse.v;
+    if (moved || mouse.buttons != mouse_sent_buttons) {
+        if (sim_mouse_report_count < SIM_REPORTS_MAX) {
+            sim_mouse_reports[sim_mouse_report_count++] = (sim_mouse_report_t){now_ms, mouse};
+        }
+        mouse_sent_buttons = mouse.buttons;
+    }
+    mouse.x = mouse.y = mouse.h = mouse.v = 0;
+    return moved;
+}
+
+uint16_t pointing_device_get_hires_scroll_resolution(void) {
+#ifdef POINTING_DEVICE_HIRES_SCROLL_MULTIPLIER
+    return POINTING_DEVICE_HIRES_SCROLL_MULTIPLIER;  // ホストが高解像度を有効にした状態
+#else
+    return 1;
+#endif
+}
+
+uint8_t keyball_get_cpi(void) {
+    return kb_cpi;
+}
+void keyball_set_cpi(uint8_t cpi) {
+    kb_cpi = cpi;
+}
+uint8_t keyball_get_scroll_div(void) {
+    return kb_scroll_div;
+}
+void keyball_set_scroll_div(uint8_t div) {
+    kb_scroll_div = div;
+}
+bool keyball_get_scroll_mode(void) {
+    return kb_scroll_mode;
+}
+void keyball_set_scroll_mode(bool mode) {
+    kb_scroll_mode = mode;
+}
+keyball_scrollsnap_mode_t keyball_get_scrollsnap_mode(void) {
+    return kb_snap_mode;
+}
+void keyball_set_scrollsnap_mode(keyball_scrollsnap_mode_t mode) {
+    kb_snap_mode = mode;
+}
+
+static mouse_xy_report_t clip_xy(int16_t v) {
+    return v < XY_REPORT_MIN ? XY_REPORT_MIN : v > XY_REPORT_MAX ? XY_REPORT_MAX : v;
+}
+
+WEAK void keyball_on_apply_motion_to_mouse_move(keyball_motion_t *m, report_mouse_t *r, bool is_left) {
+    (void)is_left;
+    r->x = clip_xy(m->x);
+    r->y = clip_xy(m->y);
+    m->x = m->y = 0;
+}
+
+WEAK void keyball_on_apply_motion_to_mouse_scroll(keyball_motion_t *m, report_mouse_t *r, bool is_left) {
+    (void)is_left;
+    uint8_t shift = kb_scroll_div - 1;
+    r->h = clip_xy(m->x >> shift);
+    r->v = clip_xy(-m->y >> shift);
+    m->x = m->y = 0;
+}
+
+void keyball_oled_render_keyinfo(void) {}
+void keyball_oled_render_ballinfo(void) {}
+void keyball_oled_render_layerinfo(void) {}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// 分割・OS判定・OLED・コンソール
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+static slave_callback_t rpc_handlers[NUM_TOTAL_TRANSACTIONS];
+
+bool is_keyboard_master(void) {
+    return true;
+}
+bool is_keyboard_left(void) {
+    return true;
+}
+void transaction_register_rpc(int8_t transaction_id, slave_callback_t callback) {
+    if (transaction_id >= 0 && transaction_id < NUM_TOTAL_TRANSACTIONS) {
+        rpc_handlers[transaction_id] = callback;
+    }
+}
+bool transaction_rpc_send(int8_t transaction_id, uint8_t initiator2target_buffer_size, const void *initiator2target_buffer) {
+    if (transaction_id < 0 || transaction_id >= NUM_TOTAL_TRANSACTIONS || !rpc_handlers[transaction_id]) {
+        return false;
+    }
+    rpc_handlers[transaction_id](initiator2target_buffer_size, initiator2target_buffer, 0, NULL);
+    return true;
+}
+
+static os_variant_t host_os;
+
+os_variant_t detected_host_os(void) {
+    return host_os;
+}
+
+void sim_set_os(os_variant_t os) {
+    host_os = os;
+    process_detected_host_os_user(os);
+}
+
+void oled_clear(void) {}
+void oled_set_cursor(uint8_t col, uint8_t line) {
+    (void)col;
+    (void)line;
+}
+void oled_write(const char *data, bool invert) {
+    (void)data;
+    (void)invert;
+}
+void oled_write_P(const char *data, bool invert) {
+    oled_write(data, invert);
+}
+void oled_write_ln(const char *data, bool invert) {
+    oled_write(data, invert);
+}
+void oled_write_ln_P(const char *data, bool invert) {
+    oled_write(data, invert);
+}
+void oled_write_char(char data, bool invert) {
+    (void)data;
+    (void)invert;
+}
+void oled_advance_page(bool clear_page) {
+    (void)clear_page;
+}
+
+const char *get_u16_str(uint16_t value, char pad) {
+    static char buf[6];
+    snprintf(buf, sizeof(buf), "%5u", value);
+    for (char *p = buf; *p == ' '; p++) {
+        *p = pad;
+    }
+    return buf;
+}
+const char *get_u8_str(uint8_t value, char pad) {
+    return get_u16_str(value, pad) + 2;
+}
+
+bool debug_enable;
+
+void uprintf(const char *fmt, ...) {
+    if (!sim_trace) {
+        return;
+    }
+    va_list ap;
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// EEPROM
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+#ifndef EECONFIG_USER_DATA_SIZE
+#    define EECONFIG_USER_DATA_SIZE 4
+#endif
+
+static uint8_t eeprom[TOTAL_EEPROM_BYTE_COUNT];
+static uint8_t eeconfig_user[EECONFIG_USER_DATA_SIZE];
+uint32_t       sim_eeprom_writes;
+uint32_t       sim_eeconfig_writes;
+
+void sim_eeprom_erase(void) {
+    memset(eeprom, 0xFF, sizeof(eeprom));
+    memset(eeconfig_user, 0xFF, sizeof(eeconfig_user));
+    sim_eeprom_writes   = 0;
+    sim_eeconfig_writes = 0;
+}
+
+static uint32_t eeprom_update(uint8_t *dst, const uint8_t *src, size_t len) {
+    uint32_t n = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (dst[i] != src[i]) {
+            dst[i] = src[i];
+            n++;
+        }
+    }
+    sim_eeprom_writes += n;
+    return n;
+}
+
+void eeconfig_read_user_datablock(void *data) {
+    memcpy(data, eeconfig_user, sizeof(eeconfig_user));
+}
+void eeconfig_update_user_datablock(const void *data) {
+    sim_eeconfig_writes += eeprom_update(eeconfig_user, data, sizeof(eeconfig_user));
+}
+
+void eeprom_read_block(void *buf, const void *addr, size_t len) {
+    uintptr_t a = (uintptr_t)addr;
+    if (a + len > sizeof(eeprom)) {
+        fprintf(stderr, "sim: eeprom read out of range %#lx+%zu\n", (unsigned long)a, len);
+        abort();
+    }
+    memcpy(buf, &eeprom[a], len);
+}
+void eeprom_update_block(const void *buf, void *addr, size_t len) {
+    uintptr_t a = (uintptr_t)addr;
+    if (a + len > sizeof(eeprom)) {
+        fprintf(stderr, "sim: eeprom write out of range %#lx+%zu\n", (unsigned long)a, len);
+        abort();
+    }
+    eeprom_update(&eeprom[a], buf, len);
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// ユーザーフックの既定
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+WEAK bool pre_process_record_user(uint16_t keycode, keyrecord_t *record) {
+    (void)keycode;
+    (void)record;
+    return true;
+}
+WEAK bool process_record_user(uint16_t keycode, keyrecord_t *record) {
+    (void)keycode;
+    (void)record;
+    return true;
+}
+WEAK void post_process_record_user(uint16_t keycode, keyrecord_t *record) {
+    (void)keycode;
+    (void)record;
+}
+WEAK layer_state_t layer_state_set_user(layer_state_t state) {
+    return state;
+}
+WEAK void keyboard_post_init_user(void) {}
+WEAK void matrix_scan_user(void) {}
+WEAK void housekeeping_task_user(void) {}
+WEAK void eeconfig_init_user(void) {}
+WEAK bool shutdown_user(bool jump_to_bootloader) {
+    (void)jump_to_bootloader;
+    return true;
+}
+WEAK bool process_detected_host_os_user(os_variant_t detected_os) {
+    (void)detected_os;
+    return true;
+}
+WEAK report_mouse_t pointing_device_task_user(report_mouse_t report) {
+    return report;
+}
+WEAK uint16_t get_tapping_term(uint16_t keycode, keyrecord_t *record) {
+    (void)keycode;
+    (void)record;
+    return TAPPING_TERM;
+}
+WEAK uint16_t keycode_at_keymap_location(uint8_t layer_num, uint8_t row, uint8_t column) {
+    return keymaps[layer_num][row][column];
+}
+
+uint16_t keymap_key_to_keycode(uint8_t layer, keypos_t key) {
+    return keycode_at_keymap_location(layer, key.row, key.col);
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// レイヤー
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+layer_state_t layer_state;
+
+// 押した時のレイヤーを覚えておき、離す時も同じレイヤーのキーコードを使う(QMKのソースレイヤーキャッシュ)
+static uint8_t source_layer[MATRIX_ROWS][MATRIX_COLS];
+
+uint8_t get_highest_layer(layer_state_t state) {
+    return state ? (uint8_t)(31 - __builtin_clz(state)) : 0;
+}
+bool layer_state_cmp(layer_state_t state, uint8_t layer) {
+    return layer == 0 ? state == 0 || (state & 1) : (state >> layer) & 1;
+}
+bool layer_state_is(uint8_t layer) {
+    return layer_state_cmp(layer_state, layer);
+}
+void layer_state_set(layer_state_t state) {
+    layer_state = layer_state_set_user(state);
+}
+void layer_on(uint8_t layer) {
+    layer_state_set(layer_state | ((layer_state_t)1 << layer));
+}
+void layer_off(uint8_t layer) {
+    layer_state_set(layer_state & ~((layer_state_t)1 << layer));
+}
+void layer_clear(void) {
+    layer_state_set(0);
+}
+
+static uint16_t record_keycode(keyrecord_t *record) {
+    uint8_t row = record->event.key.row;
+    uint8_t col = record->event.key.col;
+    if (record->event.pressed) {
+        layer_state_t state = layer_state | 1;
+        uint8_t       layer = 0;
+        for (int8_t l = 31; l > 0; l--) {
+            if ((state >> l) & 1 && keymap_key_to_keycode(l, record->event.key) != KC_TRNS) {
+                layer = l;
+                break;
+            }
+        }
+        source_layer[row][col] = layer;
+    }
+    return keymap_key_to_keycode(source_layer[row][col], record->event.key);
+}
+
+keypos_t sim_at(uint16_t keycode, uint8_t layer) {
+    keypos_t pos;
+    if (!sim_find(keycode, layer, &pos)) {
+        printf("  FAIL keycode %#06x is not on layer %u\n", keycode, layer);
+        exit(1);
+    }
+    return pos;
+}
+
+bool sim_find(uint16_t keycode, uint8_t layer, keypos_t *pos) {
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            if (keycode_at_keymap_location(layer, row, col) == keycode) {
+                *pos = (keypos_t){.col = col, .row = row};
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// アクション
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+action_t action_for_keycode(uint16_t keycode) {
+    return (action_t){.code = keycode};
+}
+
+void process_action(keyrecord_t *record, action_t action) {
+    uint16_t kc      = action.code;
+    bool     pressed = record->event.pressed;
+    if (IS_QK_LAYER_TAP(kc)) {
+        if (record->tap.count) {
+            pressed ? register_code(QK_LAYER_TAP_GET_TAP_KEYCODE(kc)) : unregister_code(QK_LAYER_TAP_GET_TAP_KEYCODE(kc));
+        } else {
+            pressed ? layer_on(QK_LAYER_TAP_GET_LAYER(kc)) : layer_off(QK_LAYER_TAP_GET_LAYER(kc));
+        }
+    } else if (IS_QK_MOD_TAP(kc)) {
+        if (record->tap.count) {
+            pressed ? register_code(QK_MOD_TAP_GET_TAP_KEYCODE(kc)) : unregister_code(QK_MOD_TAP_GET_TAP_KEYCODE(kc));
+        } else {
+            uint8_t mods = mod_config_to_bits(QK_MOD_TAP_GET_MODS(kc));
+            pressed ? add_mods(mods) : del_mods(mods);
+            send_keyboard_report();
+        }
+    } else if (IS_QK_MOMENTARY(kc)) {
+        pressed ? layer_on(QK_MOMENTARY_GET_LAYER(kc)) : layer_off(QK_MOMENTARY_GET_LAYER(kc));
+    } else if (kc != KC_NO && kc != KC_TRNS && kc <= QK_MODS_MAX) {
+        pressed ? register_code16(kc) : unregister_code16(kc);
+    }
+    // QK_BOOT・keyballのキーコード等は何もしない
+}
+
+// keyball の process_record_kb(process_record_user が true の時だけ、押下で処理)
+static void keyball_process_record(uint16_t keycode, keyrecord_t *record) {
+    if (record->event.pressed && keycode == KBC_RST) {
+        kb_cpi        = KB_CPI_DEFAULT;
+        kb_scroll_div = KB_SCROLL_DIV_DEFAULT;
+    }
+}
+
+static void process_record(keyrecord_t *record) {
+    uint16_t keycode = record_keycode(record);
+    if (process_record_user(keycode, record)) {
+        keyball_process_record(keycode, record);
+        process_action(record, action_for_keycode(keycode));
+        post_process_record_user(keycode, record);
+    }
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// Tap-Hold
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+#define WAITING_MAX 16
+
+static bool        tapping;  // 二役キーが保留中
+static keyrecord_t tapping_record;
+static keyrecord_t waiting[WAITING_MAX];
+static uint8_t     waiting_count;
+// 二役キーの判定結果(離す時の tap.count に使う)
+static uint8_t tap_count[MATRIX_ROWS][MATRIX_COLS];
+
+static bool is_tap_hold(keyrecord_t record) {
+    uint16_t kc = record_keycode(&record);
+    return IS_QK_LAYER_TAP(kc) || IS_QK_MOD_TAP(kc);
+}
+
+static uint16_t tapping_term(void) {
+    keyrecord_t r = tapping_record;
+    return get_tapping_term(record_keycode(&r), &r);
+}
+
+static void waiting_flush(void) {
+    keyrecord_t buf[WAITING_MAX];
+    uint8_t     n = waiting_count;
+    memcpy(buf, waiting, sizeof(buf[0]) * n);
+    waiting_count = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        action_tapping_process(buf[i]);
+    }
+}
+
+static void tapping_resolve(uint8_t count) {
+    tapping                 = false;
+    tapping_record.tap.count = count;
+    tap_count[tapping_record.event.key.row][tapping_record.event.key.col] = count;
+    process_record(&tapping_record);
+    waiting_flush();
+}
+
+void action_tapping_process(keyrecord_t record) {
+    uint8_t row = record.event.key.row;
+    uint8_t col = record.event.key.col;
+    if (tapping) {
+        bool same = tapping_record.event.key.row == row && tapping_record.event.key.col == col;
+        if (same && !record.event.pressed) {
+            bool tap = TIMER_DIFF_16(record.event.time, tapping_record.event.time) < tapping_term();
+            tapping_resolve(tap ? 1 : 0);
+            record.tap.count = tap_count[row][col];
+            process_record(&record);
+        } else if (waiting_count < WAITING_MAX) {
+            waiting[waiting_count++] = record;
+        }
+        return;
+    }
+    if (record.event.pressed && is_tap_hold(record)) {
+        tapping        = true;
+        tapping_record = record;
+        return;
+    }
+    if (!record.event.pressed) {
+        record.tap.count = tap_count[row][col];
+        tap_count[row][col] = 0;
+    }
+    process_record(&record);
+}
+
+static void tapping_task(void) {
+    if (tapping && TIMER_DIFF_16(timer_read(), tapping_record.event.time) >= tapping_term()) {
+        tapping_resolve(0);
+    }
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// 計測(入力イベント1回あたりのサイクル数・命令数)
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+sim_cost_t sim_cost;
+bool       sim_trace;
+int        sim_failures;
+
+static int perf_fd = -2;  // -2: 未オープン、-1: 使えない
+
+static void perf_open(void) {
+#ifdef __linux__
+    struct perf_event_attr attr = {
+        .type           = PERF_TYPE_HARDWARE,
+        .size           = sizeof(attr),
+        .config         = PERF_COUNT_HW_INSTRUCTIONS,
+        .disabled       = 1,
+        .exclude_kernel = 1,
+        .exclude_hv     = 1,
+    };
+    perf_fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+    perf_fd = -1;
+#endif
+}
+
+uint64_t sim_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;  // サイクルカウンタが無ければns
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+#endif
+}
+
+static uint64_t cost_cycles;
+static uint16_t cost_keyboard_reports;
+static uint16_t cost_mouse_reports;
+
+static void cost_begin(void) {
+    if (perf_fd == -2) {
+        perf_open();
+    }
+#ifdef __linux__
+    if (perf_fd >= 0) {
+        ioctl(perf_fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(perf_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+    cost_keyboard_reports = sim_keyboard_report_count;
+    cost_mouse_reports    = sim_mouse_report_count;
+    cost_cycles           = sim_cycles();
+}
+
+static void cost_end(const char *what) {
+    uint64_t cycles       = sim_cycles() - cost_cycles;
+    uint64_t instructions = 0;
+#ifdef __linux__
+    if (perf_fd >= 0) {
+        ioctl(perf_fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(perf_fd, &instructions, sizeof(instructions)) != sizeof(instructions)) {
+            instructions = 0;
+        }
+    }
+#endif
+    sim_cost.events++;
+    sim_cost.cycles += cycles;
+    sim_cost.cycles_max = MAX(sim_cost.cycles_max, cycles);
+    sim_cost.instructions += instructions;
+    sim_cost.instructions_max = MAX(sim_cost.instructions_max, instructions);
+    if (sim_trace) {
+        printf("%7u ms  %-12s cycles %7llu  instr ", now_ms, what, (unsigned long long)cycles);
+        perf_fd >= 0 ? printf("%7llu", (unsigned long long)instructions) : printf("      -");
+        // この入力で送られたレポート
+        for (uint16_t i = cost_keyboard_reports; i < sim_keyboard_report_count; i++) {
+            const sim_keyboard_report_t *r = &sim_keyboard_reports[i];
+            printf("  kb[%02x|%02x %02x %02x %02x %02x %02x]", r->mods, r->keys[0], r->keys[1], r->keys[2], r->keys[3], r->keys[4], r->keys[5]);
+        }
+        for (uint16_t i = cost_mouse_reports; i < sim_mouse_report_count; i++) {
+            const report_mouse_t *r = &sim_mouse_reports[i].report;
+            printf("  mouse[%02x %d,%d %d,%d]", r->buttons, r->x, r->y, r->h, r->v);
+        }
+        printf("\n");
+    }
+}
+
+void sim_cost_reset(void) {
+    memset(&sim_cost, 0, sizeof(sim_cost));
+}
+
+void sim_cost_print(const char *label) {
+    if (!sim_cost.events) {
+        return;
+    }
+    printf("%-24s %5u events  cycles avg %6llu max %7llu  instr ", label, sim_cost.events,
+           (unsigned long long)(sim_cost.cycles / sim_cost.events), (unsigned long long)sim_cost.cycles_max);
+    if (perf_fd >= 0) {
+        printf("avg %6llu max %7llu\n", (unsigned long long)(sim_cost.instructions / sim_cost.events), (unsigned long long)sim_cost.instructions_max);
+    } else {
+        printf("-\n");
+    }
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// 入力・時間
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+void sim_init(os_variant_t os) {
+    now_ms = 0;
+    memset(deferred, 0, sizeof(deferred));
+    real_mods = weak_mods = 0;
+    memset(keys, 0, sizeof(keys));
+    memset(&mouse, 0, sizeof(mouse));
+    mouse_sent_buttons = 0;
+    kb_scroll_mode     = false;
+    layer_state        = 0;
+    tapping            = false;
+    waiting_count      = 0;
+    memset(source_layer, 0, sizeof(source_layer));
+    memset(tap_count, 0, sizeof(tap_count));
+    sim_reports_clear();
+    host_os = os;
+    keyboard_post_init_user();
+    if (os != OS_UNSURE) {
+        process_detected_host_os_user(os);
+    }
+}
+
+void sim_key(uint8_t row, uint8_t col, bool pressed) {
+    keyrecord_t record = {
+        .event =
+            {
+                .key     = {.col = col, .row = row},
+                .time    = timer_read(),
+                .type    = KEY_EVENT,
+                .pressed = pressed,
+            },
+    };
+    char what[16];
+    snprintf(what, sizeof(what), "key %u,%u %s", row, col, pressed ? "dn" : "up");
+    cost_begin();
+    record.keycode = record_keycode(&record);
+    if (pre_process_record_user(record.keycode, &record)) {
+        action_tapping_process(record);
+    }
+    cost_end(what);
+}
+
+void sim_tap(uint8_t row, uint8_t col, uint16_t hold_ms) {
+    sim_key(row, col, true);
+    sim_advance(hold_ms);
+    sim_key(row, col, false);
+}
+
+void sim_ball(int16_t x, int16_t y) {
+    cost_begin();
+    keyball_motion_t m = {.x = x, .y = y};
+    report_mouse_t   r = mouse;
+    r.x = r.y = r.h = r.v = 0;
+    if (kb_scroll_mode) {
+        keyball_on_apply_motion_to_mouse_scroll(&m, &r, false);
+    } else {
+        keyball_on_apply_motion_to_mouse_move(&m, &r, false);
+    }
+    mouse = pointing_device_task_user(r);
+    pointing_device_send();
+    cost_end("ball");
+}
+
+void sim_advance(uint32_t ms) {
+    while (ms--) {
+        now_ms++;
+        deferred_task();
+        tapping_task();
+        matrix_scan_user();
+        housekeeping_task_user();
+    }
+}
@@ -0,0 +1,111 @@
+/*
+ * キーマップのホストシミュレータ
+ *
+ * keymap.c / keymap39_02.c をスタブのQMK(include/)に対してホストでビルドし、
+ * 合成した keyrecord_t を QMK と同じ順で流して、送られたHIDレポートを記録する
+ *   pre_process_record_user → Tap-Hold判定(簡易版) → process_record_user
+ *   → process_action → post_process_record_user
+ * レイヤーは layer_state_set_user を通して変える。時間は sim_advance で進める
+ * (1msごとに deferred executor → Tap-Holdのタイムアウト → matrix_scan_user
+ *  → housekeeping_task_user)
+ *
+ * 入力イベント(sim_key / sim_ball)ごとにCPUサイクル数と命令数を測る
+ * (命令数は perf_event_open が使える Linux のみ)
+ *
+ * 【ビルド】(リポジトリのルートで)
+ *   cc -std=gnu11 -O2 -Wall -Itools/host/include -include config.h \
+ *      -DQMK_KEYBOARD_H='"keyball39.h"' -o keymap_test tools/host/test_keymap.c tools/host/sim.c
+ *   test_keymap39_02.c も同じ(出力名だけ変える)
+ */
+#pragma once
+
+#include <stdio.h>
+
+#include "quantum.h"
+#include "os_detection.h"
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// 送られたHIDレポート
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+#define SIM_REPORTS_MAX 512
+
+typedef struct {
+    uint32_t time;
+    uint8_t  mods;  // 修飾(8bit、弱い修飾込み)
+    uint8_t  keys[6];
+} sim_keyboard_report_t;
+
+typedef struct {
+    uint32_t       time;
+    report_mouse_t report;
+} sim_mouse_report_t;
+
+extern sim_keyboard_report_t sim_keyboard_reports[SIM_REPORTS_MAX];
+extern uint16_t              sim_keyboard_report_count;
+extern sim_mouse_report_t    sim_mouse_reports[SIM_REPORTS_MAX];
+extern uint16_t              sim_mouse_report_count;
+
+void sim_reports_clear(void);
+
+// レポートの列から「押されたキー」を順に取り出す(押下の立ち上がりだけ)
+// mods にはそのキーが押された時の修飾が入る。戻り値は取り出した数
+uint16_t sim_pressed_keys(uint8_t *keys, uint8_t *mods, uint16_t max);
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// EEPROM(消去状態は 0xFF、書き込みは実際に変わったバイトだけ数える)
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+extern uint32_t sim_eeprom_writes;    // EEPROM全体
+extern uint32_t sim_eeconfig_writes;  // うちユーザー設定の領域(eeconfig_update_user_datablock)
+
+void sim_eeprom_erase(void);
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// 入力・時間
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// 起動(シミュレータ側の状態を消して keyboard_post_init_user を呼ぶ)
+// EEPROM とキーマップ側の static 変数はそのまま(再起動の再現に使える)
+void sim_init(os_variant_t os);
+void sim_set_os(os_variant_t os);  // OS判定の結果が変わった(process_detected_host_os_user)
+
+void sim_key(uint8_t row, uint8_t col, bool pressed);
+void sim_tap(uint8_t row, uint8_t col, uint16_t hold_ms);  // 押して hold_ms 後に離す
+void sim_ball(int16_t x, int16_t y);                       // ボールの移動量(センサーの向き)
+void sim_advance(uint32_t ms);
+uint32_t sim_now(void);
+
+// layer の表から keycode の位置を探す(keycode_at_keymap_location で引く)
+bool sim_find(uint16_t keycode, uint8_t layer, keypos_t *pos);
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// 計測
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+typedef struct {
+    uint32_t events;
+    uint64_t cycles;
+    uint64_t cycles_max;
+    uint64_t instructions;
+    uint64_t instructions_max;
+} sim_cost_t;
+
+extern sim_cost_t sim_cost;
+extern bool       sim_trace;  // true: 入力イベントごとに1行出力
+
+uint64_t sim_cycles(void);  // サイクルカウンタ(x86以外はns)
+void     sim_cost_reset(void);
+void     sim_cost_print(const char *label);
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// テスト
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+extern int sim_failures;
+
+#define CHECK(cond)                                                      \
+    do {                                                                 \
+        if (!(cond)) {                                                   \
+            printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);     \
+            sim_failures++;                                              \
+        }                                                                \
+    } while (0)
+
+// layer の keycode の位置(無ければテスト失敗で終了)
+keypos_t sim_at(uint16_t keycode, uint8_t layer);
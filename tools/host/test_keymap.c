@@ -0,0 +1,383 @@
+/*
+ * keymap.c のホストテスト(シミュレータは sim.h)
+ *
+ * keymap.c をそのまま取り込むので static な状態も見られる
+ *
+ * 【ビルド・実行】(リポジトリのルートで)
+ *   cc -std=gnu11 -O2 -Wall -Itools/host/include -include config.h \
+ *      -DQMK_KEYBOARD_H='"keyball39.h"' -o keymap_test tools/host/test_keymap.c tools/host/sim.c
+ *   ./keymap_test      (-v: イベントごとのサイクル数・命令数を出力)
+ */
+#include "../../keymap.c"
+#include "sim.h"
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// ヘルパー
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+static void key(uint16_t keycode, uint8_t layer, bool pressed) {
+    keypos_t pos = sim_at(keycode, layer);
+    sim_key(pos.row, pos.col, pressed);
+}
+
+static void tap(uint16_t keycode, uint8_t layer, uint16_t hold_ms) {
+    keypos_t pos = sim_at(keycode, layer);
+    sim_tap(pos.row, pos.col, hold_ms);
+}
+
+// 送られたキーが keys[] の順(修飾なし)か
+static bool sent(const uint8_t *expect, uint16_t n) {
+    uint8_t  got[32];
+    uint8_t  mods[32];
+    uint16_t count = sim_pressed_keys(got, mods, 32);
+    if (count != n) {
+        return false;
+    }
+    for (uint16_t i = 0; i < n; i++) {
+        if (got[i] != expect[i] || mods[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool sent1(uint8_t expect) {
+    return sent(&expect, 1);
+}
+
+// 前のテストの打鍵が判定(ストリーク・コンボ・二役キー)に残らないだけ空ける
+static void idle(void) {
+    sim_advance(2000);
+    sim_reports_clear();
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// テスト
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+static void test_basic(void) {
+    idle();
+    tap(KC_Q, 0, 30);
+    CHECK(sent1(KC_Q));
+}
+
+static void test_layer_tap(void) {
+    idle();
+    tap(LT(1, KC_ESC), 0, 50);
+    CHECK(sent1(KC_ESC));
+
+    idle();
+    key(LT(1, KC_ESC), 0, true);
+    sim_advance(300);
+    CHECK(layer_state_is(1));
+    tap(KC_7, 1, 30);
+    key(LT(1, KC_ESC), 0, false);
+    CHECK(sent1(KC_7));
+    CHECK(!layer_state_is(1));
+}
+
+static void test_ime_by_os(void) {
+    idle();
+    tap(SFT_T(IME_ON), 0, 50);
+    CHECK(sent1(KC_LNG1));
+
+    sim_set_os(OS_WINDOWS);
+    idle();
+    tap(SFT_T(IME_ON), 0, 50);
+    CHECK(sent1(KC_INT4));
+    sim_set_os(OS_MACOS);
+}
+
+// JU_*: Mac は US配列、Windows は JIS配列のキー位置で、修飾込み1レポートで送る
+// 期待値は ju_table を見ずに、文字ごとに各配列で打つキーを書いたもの
+#define SFT MOD_BIT(KC_LSFT)
+// JIS配列のキー位置(HIDのキーコード)
+#define JIS_AT KC_LBRC    // @ `
+#define JIS_CIRC KC_EQL   // ^ ~
+#define JIS_LBRC KC_RBRC  // [ {
+#define JIS_RBRC KC_BSLS  // ] }(Windowsでは KC_NUHS と同じキー)
+#define JIS_COLN KC_QUOT  // : *
+#define JIS_YEN KC_INT3   // ¥ |(Windowsでは \ になる)
+#define JIS_RO KC_INT1    // \ _
+
+static const struct {
+    uint16_t keycode;
+    char     c;
+    uint8_t  mac, mac_mods;
+    uint8_t  win, win_mods;
+} ju_expect[] = {
+    {JU_LCBR, '{', KC_LBRC, SFT, JIS_LBRC, SFT},
+    {JU_RCBR, '}', KC_RBRC, SFT, JIS_RBRC, SFT},
+    {JU_LBRC, '[', KC_LBRC, 0, JIS_LBRC, 0},
+    {JU_RBRC, ']', KC_RBRC, 0, JIS_RBRC, 0},
+    {JU_PIPE, '|', KC_BSLS, SFT, JIS_YEN, SFT},
+    {JU_BSLS, '\\', KC_BSLS, 0, JIS_YEN, 0},
+    {JU_TILD, '~', KC_GRV, SFT, JIS_CIRC, SFT},
+    {JU_GRV, '`', KC_GRV, 0, JIS_AT, SFT},
+    {JU_AT, '@', KC_2, SFT, JIS_AT, 0},
+    {JU_CIRC, '^', KC_6, SFT, JIS_CIRC, 0},
+    {JU_LPRN, '(', KC_9, SFT, KC_8, SFT},
+    {JU_RPRN, ')', KC_0, SFT, KC_9, SFT},
+    {JU_PLUS, '+', KC_EQL, SFT, KC_SCLN, SFT},
+    {JU_ASTR, '*', KC_8, SFT, JIS_COLN, SFT},
+    {JU_EQL, '=', KC_EQL, 0, KC_MINS, SFT},
+    {JU_COLN, ':', KC_SCLN, SFT, JIS_COLN, 0},
+    {JU_QUOT, '\'', KC_QUOT, 0, KC_7, SFT},
+    {JU_DQUO, '"', KC_QUOT, SFT, KC_2, SFT},
+    {JU_AMPR, '&', KC_7, SFT, KC_6, SFT},
+    {JU_UNDS, '_', KC_MINS, SFT, JIS_RO, SFT},
+};
+
+// keycode を process_record_user に直接押して離し、押下レポートが1つだけか確かめる
+static void ju_check(uint16_t keycode, char c, const char *os, uint8_t expect, uint8_t expect_mods) {
+    keyrecord_t record = {.event = {.key = {.col = 0, .row = 0}, .time = timer_read(), .type = KEY_EVENT, .pressed = true}};
+    sim_reports_clear();
+    if (process_record_user(keycode, &record)) {
+        CHECK(!"JU_* must not fall through to QMK");
+    }
+    record.event.pressed = false;
+    process_record_user(keycode, &record);
+
+    const sim_keyboard_report_t *r  = sim_keyboard_reports;
+    bool                         ok = sim_keyboard_report_count == 2 && r[0].keys[0] == expect && r[0].mods == expect_mods && r[1].keys[0] == 0 && r[1].mods == 0;
+    if (!ok) {
+        printf("  FAIL %s '%c': expected %02x|%02x, got", os, c, expect_mods, expect);
+        for (uint16_t i = 0; i < sim_keyboard_report_count; i++) {
+            printf(" %02x|%02x", r[i].mods, r[i].keys[0]);
+        }
+        printf("\n");
+        sim_failures++;
+    }
+}
+
+static void test_ju_table(void) {
+    uint8_t n = sizeof(ju_expect) / sizeof(ju_expect[0]);
+    CHECK(n == JU_LAST - JU_FIRST + 1);  // JU_* を足したら ju_expect にも足す
+    for (uint16_t kc = JU_FIRST; kc <= JU_LAST; kc++) {
+        bool found = false;
+        for (uint8_t i = 0; i < n; i++) {
+            found |= ju_expect[i].keycode == kc;
+        }
+        CHECK(found);
+    }
+
+    idle();
+    sim_set_os(OS_MACOS);
+    for (uint8_t i = 0; i < n; i++) {
+        ju_check(ju_expect[i].keycode, ju_expect[i].c, "Mac", ju_expect[i].mac, ju_expect[i].mac_mods);
+    }
+    sim_set_os(OS_WINDOWS);
+    for (uint8_t i = 0; i < n; i++) {
+        ju_check(ju_expect[i].keycode, ju_expect[i].c, "Win", ju_expect[i].win, ju_expect[i].win_mods);
+    }
+    sim_set_os(OS_MACOS);
+    sim_reports_clear();
+}
+
+// J+K = 左クリック: キーは送らず、マウスのボタンだけ押して離す
+static void test_combo_click(void) {
+    idle();
+    key(KC_J, 0, true);
+    sim_advance(10);
+    key(KC_K, 0, true);
+    sim_advance(30);
+    key(KC_J, 0, false);
+    key(KC_K, 0, false);
+    sim_advance(10);
+    CHECK(sent(NULL, 0));
+    CHECK(sim_mouse_report_count == 2);
+    CHECK(sim_mouse_reports[0].report.buttons == 1);
+    CHECK(sim_mouse_reports[1].report.buttons == 0);
+}
+
+// Shift を押したまま J(コンボの候補)を押してすぐ Shift を離しても Shift+J
+// (コンボの候補でない Q と同じ)
+static void test_combo_key_shift_roll(void) {
+    static const uint16_t letters[] = {KC_Q, KC_J};
+    for (uint8_t i = 0; i < 2; i++) {
+        uint8_t got[8];
+        uint8_t got_mods[8];
+        idle();
+        key(SFT_T(IME_ON), 0, true);
+        sim_advance(300);
+        key(letters[i], 0, true);
+        sim_advance(20);
+        key(SFT_T(IME_ON), 0, false);
+        sim_advance(20);
+        key(letters[i], 0, false);
+        CHECK(sim_pressed_keys(got, got_mods, 8) == 1 && got[0] == letters[i] && got_mods[0] == MOD_BIT(KC_LSFT));
+    }
+}
+
+// "of ": F はコンボの候補で保留になるが、連続打鍵中の Space より先に出る
+static void test_streak_space_after_combo_key(void) {
+    static const uint8_t expect[] = {KC_O, KC_F, KC_SPC};
+    idle();
+    tap(KC_O, 0, 15);
+    sim_advance(5);
+    key(KC_F, 0, true);
+    sim_advance(20);
+    key(LT(2, KC_SPC), 0, true);
+    sim_advance(20);
+    key(KC_F, 0, false);
+    key(LT(2, KC_SPC), 0, false);
+    CHECK(sent(expect, 3));
+}
+
+// Layer 2 の KMap: 単押しは ESC、1秒押し続けるとキーマップ切替
+static void test_keymap_sw(void) {
+    idle();
+    key(LT(2, KC_SPC), 0, true);
+    sim_advance(300);
+    tap(KEYMAP_SW, 2, 50);
+    key(LT(2, KC_SPC), 0, false);
+    CHECK(sent1(KC_ESC));
+    CHECK(user_config.keymap_profile == KEYMAP_MAIN);
+
+    idle();
+    key(LT(2, KC_SPC), 0, true);
+    sim_advance(300);
+    keypos_t kmap = sim_at(KEYMAP_SW, 2);
+    sim_tap(kmap.row, kmap.col, KEYMAP_SW_HOLD + 50);
+    key(LT(2, KC_SPC), 0, false);
+    CHECK(user_config.keymap_profile == KEYMAP_39_02);
+    CHECK(!sent1(KC_ESC));
+    CHECK(layer_state == 0);
+
+    // keymap39_02配列では Layer 3 の左上で戻す
+    // (離す前に表が戻るので位置は先に引いておく)
+    idle();
+    keypos_t l3 = sim_at(LT(3, KC_LCTL), 0);
+    kmap        = sim_at(KEYMAP_SW, 3);
+    sim_key(l3.row, l3.col, true);
+    sim_advance(300);
+    sim_tap(kmap.row, kmap.col, KEYMAP_SW_HOLD + 50);
+    sim_key(l3.row, l3.col, false);
+    CHECK(user_config.keymap_profile == KEYMAP_MAIN);
+    CHECK(layer_state == 0);
+}
+
+// keymap39_02配列の Layer 3: KBC_RST で戻した CPI が、レイヤーを戻しても残る
+static void test_kbc_rst(void) {
+    keypos_t l2   = sim_at(LT(2, KC_SPC), 0);
+    keypos_t kmap = sim_at(KEYMAP_SW, 2);
+    idle();
+    sim_key(l2.row, l2.col, true);
+    sim_advance(300);
+    sim_tap(kmap.row, kmap.col, KEYMAP_SW_HOLD + 50);
+    sim_key(l2.row, l2.col, false);
+    CHECK(user_config.keymap_profile == KEYMAP_39_02);
+
+    uint8_t  cpi = keyball_get_cpi();
+    keypos_t l3  = sim_at(LT(3, KC_LCTL), 0);
+    idle();
+    sim_key(l3.row, l3.col, true);
+    sim_advance(300);
+    tap(CPI_I100, 3, 30);
+    CHECK(keyball_get_cpi() == cpi + 1);
+    tap(KBC_RST, 3, 30);
+    sim_key(l3.row, l3.col, false);
+    sim_advance(10);
+    CHECK(keyball_get_cpi() == cpi);
+
+    // 元の配列へ
+    kmap = sim_at(KEYMAP_SW, 3);
+    idle();
+    sim_key(l3.row, l3.col, true);
+    sim_advance(300);
+    sim_tap(kmap.row, kmap.col, KEYMAP_SW_HOLD + 50);
+    sim_key(l3.row, l3.col, false);
+    CHECK(user_config.keymap_profile == KEYMAP_MAIN);
+}
+
+// 学習値は打鍵ごとに書かず、TT_SAVE_INTERVAL ごと・打鍵が止まった時にまとめて保存
+// 単独のホールドは学習に使わない
+static void test_tapping_term_save(void) {
+    idle();
+    sim_advance(TT_SAVE_INTERVAL);  // 前回の保存から間隔を空ける
+    sim_eeprom_writes   = 0;
+    sim_eeconfig_writes = 0;
+
+    tt_stats_t ime_on = user_config.tt[TT_IME_ON];
+    key(SFT_T(IME_ON), 0, true);
+    sim_advance(400);
+    key(SFT_T(IME_ON), 0, false);
+    CHECK(memcmp(&ime_on, &user_config.tt[TT_IME_ON], sizeof(ime_on)) == 0);
+
+    for (uint8_t i = 0; i < 20; i++) {
+        tap(LT(2, KC_SPC), 0, 60);
+        sim_advance(300);
+    }
+    CHECK(user_config_dirty);
+    CHECK(sim_eeconfig_writes == 0);  // 打鍵中は書かない
+
+    sim_advance(TT_SAVE_IDLE);
+    CHECK(!user_config_dirty);
+    CHECK(sim_eeconfig_writes > 0);
+
+    uint32_t writes = sim_eeconfig_writes;
+    for (uint8_t i = 0; i < 20; i++) {
+        tap(LT(2, KC_SPC), 0, 60);
+        sim_advance(300);
+    }
+    sim_advance(60 * 1000UL);
+    CHECK(sim_eeconfig_writes == writes);  // 次の間隔まで書かない
+}
+
+// レイヤー切替だけのキー(LTのホールド)は遅延の統計に入れない
+static void test_latency_skips_layer_keys(void) {
+    idle();
+    uint16_t count = keylat_count;
+    key(LT(1, KC_ESC), 0, true);
+    sim_advance(300);
+    key(LT(1, KC_ESC), 0, false);
+    CHECK(keylat_count == count);
+
+    tap(KC_Q, 0, 30);
+    CHECK(keylat_count == count + 1);
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// 計測: 普通の打鍵(1打鍵120ms、押下60ms)
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+static void bench_typing(void) {
+    static const uint16_t text[] = {KC_T, KC_H, KC_E, KC_Q, KC_U, KC_I, KC_C, KC_K, LT(2, KC_SPC), KC_B, KC_R, KC_O, KC_W, KC_N, LT(2, KC_SPC), KC_F, KC_O, KC_X};
+    idle();
+    sim_cost_reset();
+    for (uint8_t round = 0; round < 10; round++) {
+        for (uint8_t i = 0; i < sizeof(text) / sizeof(text[0]); i++) {
+            tap(text[i], 0, 60);
+            sim_advance(60);
+        }
+    }
+    sim_cost_print("typing");
+
+    idle();
+    sim_cost_reset();
+    for (uint16_t i = 0; i < 200; i++) {
+        sim_ball(3, -2);
+        sim_advance(8);
+    }
+    sim_cost_print("ball");
+}
+
+int main(int argc, char **argv) {
+    sim_trace = argc > 1 && strcmp(argv[1], "-v") == 0;
+
+    sim_eeprom_erase();
+    sim_init(OS_MACOS);
+
+    test_basic();
+    test_layer_tap();
+    test_ime_by_os();
+    test_ju_table();
+    test_combo_click();
+    test_streak_space_after_combo_key();
+    test_combo_key_shift_roll();
+    test_keymap_sw();
+    test_kbc_rst();
+    test_tapping_term_save();
+    test_latency_skips_layer_keys();
+    bench_typing();
+
+    printf("%s\n", sim_failures ? "FAILED" : "OK");
+    return sim_failures ? 1 : 0;
+}
@@ -0,0 +1,108 @@
+/*
+ * keymap39_02.c のホストテスト(シミュレータは sim.h)
+ *
+ * 【ビルド・実行】(リポジトリのルートで)
+ *   cc -std=gnu11 -O2 -Wall -Itools/host/include -include config.h \
+ *      -DQMK_KEYBOARD_H='"keyball39.h"' -o keymap39_02_test tools/host/test_keymap39_02.c tools/host/sim.c
+ *   ./keymap39_02_test      (-v: イベントごとのサイクル数・命令数を出力)
+ */
+#include "../../keymap39_02.c"
+#include "sim.h"
+
+static void key(uint16_t keycode, uint8_t layer, bool pressed) {
+    keypos_t pos = sim_at(keycode, layer);
+    sim_key(pos.row, pos.col, pressed);
+}
+
+static void tap(uint16_t keycode, uint8_t layer, uint16_t hold_ms) {
+    keypos_t pos = sim_at(keycode, layer);
+    sim_tap(pos.row, pos.col, hold_ms);
+}
+
+static bool sent1(uint8_t expect, uint8_t mods) {
+    uint8_t got[8];
+    uint8_t got_mods[8];
+    return sim_pressed_keys(got, got_mods, 8) == 1 && got[0] == expect && got_mods[0] == mods;
+}
+
+static void idle(void) {
+    sim_advance(2000);
+    sim_reports_clear();
+}
+
+static void test_layer_tap(void) {
+    idle();
+    tap(LT(1, KC_BSPC), 0, 50);
+    CHECK(sent1(KC_BSPC, 0));
+
+    idle();
+    key(LT(1, KC_BSPC), 0, true);
+    sim_advance(300);
+    tap(KC_LPRN, 1, 30);
+    key(LT(1, KC_BSPC), 0, false);
+    CHECK(sent1(KC_9, MOD_BIT(KC_LSFT)));
+}
+
+// Layer 1 はスクロール(高解像度スクロールでもノッチ単位で送る)
+static void test_scroll(void) {
+    idle();
+    key(LT(1, KC_BSPC), 0, true);
+    sim_advance(300);
+    CHECK(keyball_get_scroll_mode());
+    CHECK(split_state_received & SPLIT_STATE_SCROLL);  // 副側へ同期
+    sim_ball(0, 8);
+    key(LT(1, KC_BSPC), 0, false);
+    sim_advance(1);
+    CHECK(!keyball_get_scroll_mode());
+    CHECK(sim_mouse_report_count == 1);
+    CHECK(abs(sim_mouse_reports[0].report.v) == pointing_device_get_hires_scroll_resolution());
+    CHECK(sim_mouse_reports[0].report.h == 0);
+}
+
+// 大きく回しても 1レポートに入りきらない分は次のレポートで送る
+static void test_scroll_carry(void) {
+    int16_t res = pointing_device_get_hires_scroll_resolution();
+    int32_t sum = 0;
+    idle();
+    key(LT(1, KC_BSPC), 0, true);
+    sim_advance(300);
+    sim_ball(0, 8 * 8);  // 8ノッチ
+    for (uint8_t i = 0; i < 4; i++) {
+        sim_ball(0, 0);
+    }
+    key(LT(1, KC_BSPC), 0, false);
+    CHECK(sim_mouse_report_count > 1);
+    for (uint16_t i = 0; i < sim_mouse_report_count; i++) {
+        CHECK(abs(sim_mouse_reports[i].report.v) <= 127);
+        sum += sim_mouse_reports[i].report.v;
+    }
+    CHECK(abs(sum) == 8 * res);
+}
+
+static void bench_typing(void) {
+    static const uint16_t text[] = {KC_T, KC_H, KC_E, KC_Q, KC_U, KC_I, KC_C, KC_K, LT(2, KC_SPC), KC_B, KC_R, KC_O, KC_W, KC_N, LT(2, KC_SPC), KC_F, KC_O, KC_X};
+    idle();
+    sim_cost_reset();
+    for (uint8_t round = 0; round < 10; round++) {
+        for (uint8_t i = 0; i < sizeof(text) / sizeof(text[0]); i++) {
+            tap(text[i], 0, 60);
+            sim_advance(60);
+        }
+    }
+    sim_cost_print("typing");
+}
+
+int main(int argc, char **argv) {
+    sim_trace = argc > 1 && strcmp(argv[1], "-v") == 0;
+
+    sim_eeprom_erase();
+    sim_init(OS_MACOS);
+
+    test_layer_tap();
+    test_scroll();
+    test_scroll_carry();
+    bench_typing();
+
+    printf("%s\n", sim_failures ? "FAILED" : "OK");
+    return sim_failures ? 1 : 0;
+}
@@ -0,0 +1,921 @@
+/*
+ * Keyball39 レイアウト評価・最適化ツール(ホスト側)
+ *
+ * keymap.c / keymap39_02.c の LAYOUT_right_ball の表をそのまま読み、
+ * 打鍵データで各レイアウトを採点する。レイヤー内のキー入れ替えも提案する
+ *
+ * 【ビルド】
+ *   c++ -O2 -std=c++17 -o layout_cost tools/layout_cost.cpp
+ *
+ * 【使い方】
+ *   layout_cost [オプション] ファイル[:配列名] ...
+ *     例: layout_cost --text corpus.txt keymap.c keymap.c:keymaps_39_02 keymap39_02.c
+ *         layout_cost --heat main.log --heat 39_02.log keymap.c keymap.c:keymaps_39_02
+ *   配列名の既定は keymaps
+ *
+ *   --text FILE      テキスト(ASCII)を各レイアウトで打った時の打鍵列で採点
+ *                    Shift・レイヤーキーの押下も打鍵として数える
+ *   --heat FILE      STAT_PG の HEAT ページのコンソール出力("heat ..." の行)
+ *                    複数指定すると n 番目のレイアウトに n 番目を使う(1つなら全部に使う)
+ *                    位置別の回数はレイヤーを区別しないので Layer 0 のキーとして扱い、
+ *                    レイヤー切替は Layer 1 以上での打鍵数で数える
+ *   --optimize N     各レイアウトで改善する入れ替えを最大 N 個提案(山登り法)
+ *   --swap-thumbs    親指キーも入れ替えの対象にする
+ *   --weights T,S,L,H  採点の重み(移動量, 同指連続, レイヤー切替, Tap-Hold、既定 1,3,1,0.5)
+ *   --show           読み込んだ表を表示
+ *
+ * 【採点】100打鍵あたりのコスト(小さいほど良い)
+ *   移動量:     指のホーム位置からキーまでの距離(キー1個 = 1)
+ *   同指連続:   同じ指で違うキーを続けて押した回数
+ *   レイヤー切替: Layer 0 以外に入った回数
+ *   Tap-Hold:   二役キー(LT/MT/XXX_T/TAB_CTGUI/SLSH_SCRL)の押下回数(誤判定の機会)
+ * 入れ替えで変わるのは移動量と同指連続だけ(レイヤーは入れ替えで変わらない)
+ *
+ * 物理配置は keyball39.h の LAYOUT_right_ball(8行 x 6列のマトリクス)に合わせる
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// 物理配置
+//
+// LAYOUT_right_ball の引数順(39個):
+//   0- 9: 上段 L00..L04, R04..R00
+//  10-19: 中段
+//  20-29: 下段
+//  30-38: L30 L31 L32 L33 L34 L35, R35 R34, R30
+// 右手の列番号は外側(小指)が0。座標はキー単位、各手の小指列が x=0
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+constexpr int KEY_COUNT    = 39;
+constexpr int MATRIX_ROWS  = 8;
+constexpr int MATRIX_COLS  = 6;
+constexpr int FINGER_COUNT = 10;
+
+enum finger {
+    L_PINKY, L_RING, L_MIDDLE, L_INDEX, L_THUMB,
+    R_THUMB, R_INDEX, R_MIDDLE, R_RING, R_PINKY,
+};
+
+const char *const finger_names[FINGER_COUNT] = {
+    "L-pinky", "L-ring", "L-middle", "L-index", "L-thumb",
+    "R-thumb", "R-index", "R-middle", "R-ring", "R-pinky",
+};
+
+struct key_geom {
+    int    row, col;  // マトリクス位置(HEATのダンプと同じ)
+    int    finger;
+    double x, y;
+};
+
+// 列ごとの縦のずれ(カラムスタッガード、中指が一番奥)
+constexpr double column_stagger[5] = {0.40, 0.15, 0.0, 0.15, 0.25};
+
+struct geometry {
+    key_geom keys[KEY_COUNT];
+    double   travel[KEY_COUNT];  // ホーム位置からの距離
+    int      arg_of[MATRIX_ROWS][MATRIX_COLS];
+
+    geometry() {
+        static const int left_finger[5]  = {L_PINKY, L_RING, L_MIDDLE, L_INDEX, L_INDEX};
+        static const int right_finger[5] = {R_PINKY, R_RING, R_MIDDLE, R_INDEX, R_INDEX};
+        for (int r = 0; r < 3; r++) {
+            for (int k = 0; k < 5; k++) {
+                keys[r * 10 + k]     = {r, k, left_finger[k], double(k), r + column_stagger[k]};
+                int x                = 4 - k;  // 右手は内側から外側へ並ぶ
+                keys[r * 10 + 5 + k] = {4 + r, x, right_finger[x], double(x), r + column_stagger[x]};
+            }
+        }
+        keys[30] = {3, 0, L_PINKY, 0.0, 3 + column_stagger[0]};
+        keys[31] = {3, 1, L_RING, 1.0, 3 + column_stagger[1]};
+        keys[32] = {3, 2, L_THUMB, 2.6, 4.0};
+        keys[33] = {3, 3, L_THUMB, 3.7, 4.1};
+        keys[34] = {3, 4, L_THUMB, 4.8, 4.3};
+        keys[35] = {3, 5, L_THUMB, 5.9, 4.7};
+        keys[36] = {7, 5, R_THUMB, 5.2, 4.5};
+        keys[37] = {7, 4, R_THUMB, 4.1, 4.2};
+        keys[38] = {7, 0, R_PINKY, 0.0, 3 + column_stagger[0]};
+
+        // ホーム: 指は中段、親指は親指キーの中心
+        double hx[FINGER_COUNT] = {}, hy[FINGER_COUNT] = {};
+        int    hn[FINGER_COUNT] = {};
+        for (int i = 0; i < KEY_COUNT; i++) {
+            const key_geom &k      = keys[i];
+            bool            thumb  = k.finger == L_THUMB || k.finger == R_THUMB;
+            bool            home   = thumb || (i >= 10 && i < 20 && i % 10 != 4 && i % 10 != 5);
+            if (home) {
+                hx[k.finger] += k.x;
+                hy[k.finger] += k.y;
+                hn[k.finger]++;
+            }
+        }
+        for (int i = 0; i < KEY_COUNT; i++) {
+            const key_geom &k = keys[i];
+            travel[i]         = std::hypot(k.x - hx[k.finger] / hn[k.finger], k.y - hy[k.finger] / hn[k.finger]);
+        }
+
+        for (auto &row : arg_of) {
+            std::fill(std::begin(row), std::end(row), -1);
+        }
+        for (int i = 0; i < KEY_COUNT; i++) {
+            arg_of[keys[i].row][keys[i].col] = i;
+        }
+    }
+
+    bool is_thumb(int arg) const {
+        return keys[arg].finger == L_THUMB || keys[arg].finger == R_THUMB;
+    }
+};
+
+const geometry geom;
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// キーマップの読み込み
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+struct layout {
+    std::string                           name;
+    std::vector<std::vector<std::string>> layers;  // [layer][arg] 正規化したキーコード
+};
+
+[[noreturn]] void fail(const std::string &msg) {
+    std::fprintf(stderr, "layout_cost: %s\n", msg.c_str());
+    std::exit(1);
+}
+
+std::string read_file(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        fail("cannot open " + path);
+    }
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+// コメントを空白に置き換える(文字列・文字リテラルの中は残す)
+std::string strip_comments(const std::string &src) {
+    std::string out = src;
+    size_t      i   = 0;
+    while (i < out.size()) {
+        char c = out[i];
+        if (c == '"' || c == '\'') {
+            for (i++; i < out.size() && out[i] != c && out[i] != '\n'; i++) {
+                if (out[i] == '\\') {
+                    i++;
+                }
+            }
+            i++;
+        } else if (c == '/' && i + 1 < out.size() && out[i + 1] == '/') {
+            // 行末の \ は行連結(keymap39_02.c の BACKSLS の件)なので次の行まで
+            while (i < out.size() && out[i] != '\n') {
+                bool splice = out[i] == '\\' && i + 1 < out.size() && out[i + 1] == '\n';
+                out[i]      = ' ';
+                i += splice ? 2 : 1;
+            }
+        } else if (c == '/' && i + 1 < out.size() && out[i + 1] == '*') {
+            size_t end = out.find("*/", i + 2);
+            end        = end == std::string::npos ? out.size() : end + 2;
+            for (; i < end; i++) {
+                if (out[i] != '\n') {
+                    out[i] = ' ';
+                }
+            }
+        } else {
+            i++;
+        }
+    }
+    return out;
+}
+
+bool is_ident(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+std::string remove_spaces(const std::string &s) {
+    std::string out;
+    for (char c : s) {
+        if (!std::isspace(static_cast<unsigned char>(c))) {
+            out += c;
+        }
+    }
+    return out;
+}
+
+// 引数なしの #define(キー名の別名)を集める
+std::map<std::string, std::string> collect_aliases(const std::string &src) {
+    std::map<std::string, std::string> aliases;
+    std::istringstream                 lines(src);
+    std::string                        line;
+    while (std::getline(lines, line)) {
+        size_t p = line.find_first_not_of(" \t");
+        if (p == std::string::npos || line.compare(p, 7, "#define") != 0) {
+            continue;
+        }
+        p = line.find_first_not_of(" \t", p + 7);
+        if (p == std::string::npos) {
+            continue;
+        }
+        size_t e = p;
+        while (e < line.size() && is_ident(line[e])) {
+            e++;
+        }
+        if (e == p || (e < line.size() && line[e] == '(')) {
+            continue;  // 関数形式のマクロは対象外
+        }
+        std::string body = remove_spaces(line.substr(e));
+        if (!body.empty()) {
+            aliases[line.substr(p, e - p)] = body;
+        }
+    }
+    return aliases;
+}
+
+std::string resolve_alias(std::string token, const std::map<std::string, std::string> &aliases) {
+    for (int depth = 0; depth < 8; depth++) {
+        auto it = aliases.find(token);
+        if (it == aliases.end()) {
+            break;
+        }
+        token = it->second;
+    }
+    return token;
+}
+
+size_t match_close(const std::string &s, size_t open, char o, char c) {
+    int depth = 0;
+    for (size_t i = open; i < s.size(); i++) {
+        if (s[i] == o) {
+            depth++;
+        } else if (s[i] == c && --depth == 0) {
+            return i;
+        }
+    }
+    return std::string::npos;
+}
+
+layout load_layout(const std::string &spec) {
+    std::string path  = spec;
+    std::string table = "keymaps";
+    size_t      colon = spec.rfind(':');
+    if (colon != std::string::npos && colon > 1) {  // Windowsのドライブ名は除く
+        path  = spec.substr(0, colon);
+        table = spec.substr(colon + 1);
+    }
+
+    std::string src     = strip_comments(read_file(path));
+    auto        aliases = collect_aliases(src);
+
+    // 「配列名[」の後の = { ... } を探す
+    size_t body = std::string::npos;
+    for (size_t p = src.find(table); p != std::string::npos; p = src.find(table, p + 1)) {
+        size_t after = p + table.size();
+        if ((p > 0 && is_ident(src[p - 1])) || after >= src.size() || is_ident(src[after])) {
+            continue;
+        }
+        size_t q = src.find_first_not_of(" \t\r\n", after);
+        if (q == std::string::npos || src[q] != '[') {
+            continue;
+        }
+        size_t eq = src.find('=', q);
+        size_t sc = src.find(';', q);
+        if (eq != std::string::npos && eq < sc) {
+            body = src.find('{', eq);
+            break;
+        }
+    }
+    if (body == std::string::npos) {
+        fail("table " + table + " not found in " + path);
+    }
+    size_t body_end = match_close(src, body, '{', '}');
+
+    layout out;
+    out.name = path + ":" + table;
+
+    const std::string macro = "LAYOUT_right_ball";
+    int               next  = 0;
+    for (size_t p = src.find(macro, body); p != std::string::npos && p < body_end; p = src.find(macro, p + 1)) {
+        // [n] = の指定(なければ順番)
+        int    index = next;
+        size_t eq    = src.find_last_not_of(" \t\r\n", p - 1);
+        if (eq != std::string::npos && src[eq] == '=') {
+            size_t close = src.find_last_not_of(" \t\r\n", eq - 1);
+            size_t open  = src.rfind('[', close);
+            if (close != std::string::npos && src[close] == ']' && open != std::string::npos) {
+                std::string designator = resolve_alias(remove_spaces(src.substr(open + 1, close - open - 1)), aliases);
+                char       *end        = nullptr;
+                long        v          = std::strtol(designator.c_str(), &end, 0);
+                if (*end != '\0') {
+                    fail("cannot evaluate layer index [" + designator + "] in " + out.name);
+                }
+                index = int(v);
+            }
+        }
+
+        size_t open  = src.find('(', p);
+        size_t close = match_close(src, open, '(', ')');
+        if (close == std::string::npos) {
+            fail("unterminated " + macro + " in " + out.name);
+        }
+
+        std::vector<std::string> args;
+        int                      depth = 0;
+        size_t                   start = open + 1;
+        for (size_t i = open + 1; i <= close; i++) {
+            char c = src[i];
+            if (c == '(') {
+                depth++;
+            } else if (c == ')' && depth > 0) {
+                depth--;
+            } else if ((c == ',' && depth == 0) || i == close) {
+                args.push_back(resolve_alias(remove_spaces(src.substr(start, i - start)), aliases));
+                start = i + 1;
+            }
+        }
+        if (args.size() != KEY_COUNT) {
+            fail(out.name + ": layer " + std::to_string(index) + " has " + std::to_string(args.size()) + " keys, expected " + std::to_string(KEY_COUNT));
+        }
+
+        if (index < 0 || index > 31) {
+            fail(out.name + ": bad layer index " + std::to_string(index));
+        }
+        if (out.layers.size() <= size_t(index)) {
+            out.layers.resize(index + 1, std::vector<std::string>(KEY_COUNT, "_______"));
+        }
+        out.layers[index] = args;
+        next              = index + 1;
+        p                 = close;
+    }
+    if (out.layers.empty()) {
+        fail("no " + macro + " in " + out.name);
+    }
+    return out;
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// キーコードの意味(タップで出るキー・ホールドの役割)
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+bool is_transparent(const std::string &kc) {
+    return kc == "_______" || kc == "KC_TRNS" || kc == "KC_TRANSPARENT";
+}
+
+std::string inner_arg(const std::string &kc, size_t open) {
+    size_t close = kc.rfind(')');
+    return close == std::string::npos || close <= open ? std::string() : kc.substr(open + 1, close - open - 1);
+}
+
+// 単押しで送るキー
+std::string tap_keycode(const std::string &kc) {
+    if (kc == "TAB_CTGUI") {
+        return "KC_TAB";
+    }
+    if (kc == "SLSH_SCRL") {
+        return "KC_SLSH";
+    }
+    size_t open = kc.find('(');
+    if (open == std::string::npos) {
+        return kc;
+    }
+    std::string head = kc.substr(0, open);
+    std::string arg  = inner_arg(kc, open);
+    if (head == "LT" || head == "MT") {
+        size_t comma = arg.find(',');
+        return comma == std::string::npos ? arg : arg.substr(comma + 1);
+    }
+    if (head.size() > 2 && head.compare(head.size() - 2, 2, "_T") == 0) {
+        return arg;
+    }
+    return kc;
+}
+
+// 長押しで入るレイヤー(なければ -1)
+int hold_layer(const std::string &kc) {
+    size_t open = kc.find('(');
+    if (open == std::string::npos) {
+        return -1;
+    }
+    std::string head = kc.substr(0, open);
+    if (head != "LT" && head != "MO") {
+        return -1;
+    }
+    return std::atoi(inner_arg(kc, open).c_str());
+}
+
+bool is_shift_hold(const std::string &kc) {
+    for (const char *p : {"SFT_T(", "LSFT_T(", "RSFT_T(", "MT(MOD_LSFT", "MT(MOD_RSFT"}) {
+        if (kc.compare(0, std::strlen(p), p) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool is_tap_hold(const std::string &kc) {
+    if (kc == "TAB_CTGUI" || kc == "SLSH_SCRL") {
+        return true;
+    }
+    size_t open = kc.find('(');
+    if (open == std::string::npos) {
+        return false;
+    }
+    std::string head = kc.substr(0, open);
+    return head == "LT" || head == "MT" || (head.size() > 2 && head.compare(head.size() - 2, 2, "_T") == 0);
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// 打鍵データ
+//
+// slot = layer * KEY_COUNT + arg(データを取ったレイアウトでの位置)
+// 単打鍵・2打鍵連続の回数を密な配列で持つ(スロット数は最大 32 x 39)
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+struct dataset {
+    int                   slots = 0;
+    std::vector<uint64_t> uni;  // [slot]
+    std::vector<uint64_t> bi;   // [from * slots + to]
+    uint64_t              presses        = 0;
+    uint64_t              layer_switches = 0;
+    uint64_t              skipped        = 0;  // 打てなかった文字・読めなかった行
+
+    explicit dataset(int layer_count) : slots(layer_count * KEY_COUNT), uni(slots), bi(size_t(slots) * slots) {}
+
+    void press(int slot, int &prev) {
+        uni[slot]++;
+        presses++;
+        if (prev >= 0) {
+            bi[size_t(prev) * slots + slot]++;
+        }
+        prev = slot;
+    }
+};
+
+// 1文字を打つ手順
+struct char_plan {
+    int slot       = -1;  // -1 = 打てない
+    int shift_slot = -1;
+    int layer      = 0;
+    int layer_slot = -1;  // Layer 0 上のレイヤーキー
+};
+
+struct char_keys {
+    char        c;
+    const char *names[2];
+    const char *shifted;  // Shift + このキーでも打てる
+};
+
+// clang-format off
+const char_keys symbol_keys[] = {
+    {'!',  {"KC_EXLM", nullptr},   "KC_1"},    {'@',  {"KC_AT",   "JU_AT"},   "KC_2"},
+    {'#',  {"KC_HASH", nullptr},   "KC_3"},    {'$',  {"KC_DLR",  nullptr},   "KC_4"},
+    {'%',  {"KC_PERC", nullptr},   "KC_5"},    {'^',  {"KC_CIRC", "JU_CIRC"}, "KC_6"},
+    {'&',  {"KC_AMPR", "JU_AMPR"}, "KC_7"},    {'*',  {"KC_ASTR", "JU_ASTR"}, "KC_8"},
+    {'(',  {"KC_LPRN", "JU_LPRN"}, "KC_9"},    {')',  {"KC_RPRN", "JU_RPRN"}, "KC_0"},
+    {'-',  {"KC_MINS", nullptr},   nullptr},   {'_',  {"KC_UNDS", "JU_UNDS"}, "KC_MINS"},
+    {'=',  {"KC_EQL",  "JU_EQL"},  nullptr},   {'+',  {"KC_PLUS", "JU_PLUS"}, "KC_EQL"},
+    {'[',  {"KC_LBRC", "JU_LBRC"}, nullptr},   {'{',  {"KC_LCBR", "JU_LCBR"}, "KC_LBRC"},
+    {']',  {"KC_RBRC", "JU_RBRC"}, nullptr},   {'}',  {"KC_RCBR", "JU_RCBR"}, "KC_RBRC"},
+    {'\\', {"KC_BSLS", "JU_BSLS"}, nullptr},   {'|',  {"KC_PIPE", "JU_PIPE"}, "KC_BSLS"},
+    {';',  {"KC_SCLN", nullptr},   nullptr},   {':',  {"KC_COLN", "JU_COLN"}, "KC_SCLN"},
+    {'\'', {"KC_QUOT", "JU_QUOT"}, nullptr},   {'"',  {"KC_DQUO", "JU_DQUO"}, "KC_QUOT"},
+    {'`',  {"KC_GRV",  "JU_GRV"},  nullptr},   {'~',  {"KC_TILD", "JU_TILD"}, "KC_GRV"},
+    {',',  {"KC_COMM", nullptr},   nullptr},   {'<',  {"KC_LABK", "KC_LT"},   "KC_COMM"},
+    {'.',  {"KC_DOT",  nullptr},   nullptr},   {'>',  {"KC_RABK", "KC_GT"},   "KC_DOT"},
+    {'/',  {"KC_SLSH", nullptr},   nullptr},   {'?',  {"KC_QUES", nullptr},   "KC_SLSH"},
+    {' ',  {"KC_SPC",  "KC_SPACE"}, nullptr},  {'\n', {"KC_ENT",  "KC_ENTER"}, nullptr},
+    {'\t', {"KC_TAB",  nullptr},   nullptr},
+};
+// clang-format on
+
+class char_mapper {
+   public:
+    explicit char_mapper(const layout &lay) : lay_(lay) {
+        for (int l = 0; l < int(lay.layers.size()); l++) {
+            for (int a = 0; a < KEY_COUNT; a++) {
+                const std::string &kc = lay.layers[l][a];
+                int                hl = hold_layer(kc);
+                if (l == 0 && hl > 0 && hl < int(layer_key_.size()) && layer_key_[hl] < 0) {
+                    layer_key_[hl] = a;
+                }
+                if (l == 0 && shift_slot_ < 0 && (is_shift_hold(kc) || tap_keycode(kc) == "KC_LSFT" || tap_keycode(kc) == "KC_RSFT")) {
+                    shift_slot_ = a;
+                }
+            }
+        }
+        for (int c = 'a'; c <= 'z'; c++) {
+            std::string kc = std::string("KC_") + char(std::toupper(c));
+            plan_[c]       = plan({kc.c_str()}, nullptr);
+            plan_[std::toupper(c)] = plan({}, kc.c_str());
+        }
+        for (int c = '0'; c <= '9'; c++) {
+            std::string kc = std::string("KC_") + char(c);
+            plan_[c]       = plan({kc.c_str()}, nullptr);
+        }
+        for (const char_keys &ck : symbol_keys) {
+            std::vector<const char *> names;
+            for (const char *n : ck.names) {
+                if (n) {
+                    names.push_back(n);
+                }
+            }
+            plan_[static_cast<unsigned char>(ck.c)] = plan(names, ck.shifted);
+        }
+    }
+
+    const char_plan &operator[](unsigned char c) const {
+        return plan_[c];
+    }
+
+   private:
+    // 候補の順: Layer 0 そのまま → Layer 0 + Shift → 上のレイヤー → 上のレイヤー + Shift
+    char_plan plan(const std::vector<const char *> &names, const char *shifted) const {
+        char_plan p;
+        for (int pass = 0; pass < 4; pass++) {
+            bool upper = pass >= 2;
+            bool shift = pass % 2 == 1;
+            if (shift && (!shifted || shift_slot_ < 0)) {
+                continue;
+            }
+            for (int l = upper ? 1 : 0; l < (upper ? int(lay_.layers.size()) : 1); l++) {
+                if (l > 0 && (l >= int(layer_key_.size()) || layer_key_[l] < 0)) {
+                    continue;
+                }
+                for (int a = 0; a < KEY_COUNT; a++) {
+                    std::string tap = tap_keycode(lay_.layers[l][a]);
+                    bool        hit = false;
+                    if (shift) {
+                        hit = tap == shifted;
+                    } else {
+                        for (const char *n : names) {
+                            hit = hit || tap == n;
+                        }
+                    }
+                    if (hit) {
+                        p.slot       = l * KEY_COUNT + a;
+                        p.shift_slot = shift ? shift_slot_ : -1;
+                        p.layer      = l;
+                        p.layer_slot = l > 0 ? layer_key_[l] : -1;
+                        return p;
+                    }
+                }
+            }
+        }
+        return p;
+    }
+
+    const layout    &lay_;
+    std::vector<int> layer_key_ = std::vector<int>(32, -1);
+    int              shift_slot_ = -1;
+    char_plan        plan_[256];
+};
+
+// テキストを打った時の打鍵列を集計
+dataset load_text(const std::string &path, const layout &lay) {
+    dataset     data(int(lay.layers.size()));
+    char_mapper map(lay);
+
+    std::FILE *f = std::fopen(path.c_str(), "rb");
+    if (!f) {
+        fail("cannot open " + path);
+    }
+    std::vector<unsigned char> buf(1 << 20);
+    int                        prev  = -1;
+    int                        layer = 0;
+    size_t                     n;
+    while ((n = std::fread(buf.data(), 1, buf.size(), f)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            unsigned char c = buf[i];
+            if (c == '\r') {
+                continue;
+            }
+            const char_plan &p = map[c];
+            if (p.slot < 0) {
+                data.skipped++;
+                continue;
+            }
+            if (p.layer != layer) {
+                layer = p.layer;
+                if (layer > 0) {  // レイヤーキーは続けて同じレイヤーを使う間は押しっぱなし
+                    data.layer_switches++;
+                    data.press(p.layer_slot, prev);
+                }
+            }
+            if (p.shift_slot >= 0) {
+                data.press(p.shift_slot, prev);
+            }
+            data.press(p.slot, prev);
+        }
+    }
+    std::fclose(f);
+    return data;
+}
+
+// STAT_PG の HEAT ダンプ(ログの途中に混ざっていてもよい)
+dataset load_heat(const std::string &path, const layout &lay) {
+    dataset            data(int(lay.layers.size()));
+    std::istringstream lines(read_file(path));
+    std::string        line;
+    auto               slot_of = [](unsigned row, unsigned col) {
+        return row < MATRIX_ROWS && col < MATRIX_COLS ? geom.arg_of[row][col] : -1;
+    };
+    while (std::getline(lines, line)) {
+        size_t p = line.find("heat ");
+        if (p == std::string::npos) {
+            continue;
+        }
+        std::istringstream in(line.substr(p + 5));
+        std::string        kind;
+        in >> kind;
+        unsigned long a, b, c, d, count;
+        if (kind == "pos" && in >> a >> b >> count) {
+            int s = slot_of(a, b);
+            if (s < 0) {
+                data.skipped++;
+                continue;
+            }
+            data.uni[s] += count;
+            data.presses += count;
+        } else if (kind == "bigram" && in >> a >> b >> c >> d >> count) {
+            int s = slot_of(a, b), t = slot_of(c, d);
+            if (s < 0 || t < 0) {
+                data.skipped++;
+                continue;
+            }
+            data.bi[size_t(s) * data.slots + t] += count;
+        } else if (kind == "layer" && in >> a >> count) {
+            if (a > 0) {
+                data.layer_switches += count;
+            }
+        }
+    }
+    return data;
+}
+
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+// 採点
+//
+// pos[slot] が今の配置での位置(入れ替えで動く)
+// ━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━
+struct weights {
+    double travel = 1.0, sfb = 3.0, layer = 1.0, tap_hold = 0.5;
+};
+
+struct metrics {
+    double   travel   = 0;
+    uint64_t sfb      = 0;
+    uint64_t tap_hold = 0;
+};
+
+class scorer {
+   public:
+    scorer(const dataset &data, const layout &lay, const weights &w) : data_(data), lay_(lay), w_(w), n_(data.slots), pos_(n_), u_(n_), b_(size_t(n_) * n_) {
+        for (int s = 0; s < n_; s++) {
+            pos_[s] = s % KEY_COUNT;
+            u_[s]   = double(data.uni[s]);
+        }
+        for (size_t i = 0; i < b_.size(); i++) {
+            b_[i] = double(data.bi[i]);
+        }
+    }
+
+    metrics measure() const {
+        metrics m;
+        for (int s = 0; s < n_; s++) {
+            m.travel += u_[s] * geom.travel[pos_[s]];
+            if (is_tap_hold(lay_.layers[s / KEY_COUNT][s % KEY_COUNT])) {
+                m.tap_hold += data_.uni[s];
+            }
+            for (int t = 0; t < n_; t++) {
+                if (same_finger(s, t)) {
+                    m.sfb += data_.bi[size_t(s) * n_ + t];
+                }
+            }
+        }
+        return m;
+    }
+
+    // 100打鍵あたりのコスト
+    double score(const metrics &m) const {
+        if (!data_.presses) {
+            return 0;
+        }
+        double cost = w_.travel * m.travel + w_.sfb * double(m.sfb) + w_.layer * double(data_.layer_switches) + w_.tap_hold * double(m.tap_hold);
+        return cost * 100.0 / double(data_.presses);
+    }
+
+    // slot s と t の位置を入れ替えた時のコストの差(入れ替えで変わる項だけ)
+    double swap_delta(int s, int t) {
+        double before = local_cost(s, t);
+        std::swap(pos_[s], pos_[t]);
+        double after = local_cost(s, t);
+        std::swap(pos_[s], pos_[t]);
+        return (after - before) * 100.0 / double(std::max<uint64_t>(data_.presses, 1));
+    }
+
+    void apply_swap(int s, int t) {
+        std::swap(pos_[s], pos_[t]);
+    }
+
+    int pos(int slot) const {
+        return pos_[slot];
+    }
+
+   private:
+    bool same_finger(int s, int t) const {
+        return pos_[s] != pos_[t] && geom.keys[pos_[s]].finger == geom.keys[pos_[t]].finger;
+    }
+
+    // s か t を含む項だけ足す(各組は1回ずつ)
+    double local_cost(int s, int t) const {
+        double cost = w_.travel * (u_[s] * geom.travel[pos_[s]] + u_[t] * geom.travel[pos_[t]]);
+        double sfb  = 0;
+        for (int y = 0; y < n_; y++) {
+            sfb += b_[size_t(s) * n_ + y] * same_finger(s, y) + b_[size_t(t) * n_ + y] * same_finger(t, y);
+            if (y != s && y != t) {
+                sfb += b_[size_t(y) * n_ + s] * same_finger(y, s) + b_[size_t(y) * n_ + t] * same_finger(y, t);
+            }
+        }
+        return cost + w_.sfb * sfb;
+    }
+
+    const dataset      &data_;
+    const layout       &lay_;
+    weights             w_;
+    int                 n_;
+    std::vector<int>    pos_;
+    std::vector<double> u_;
+    std::vector<double> b_;
+};
+
+void print_metrics(const layout &lay, const dataset &data, const scorer &sc) {
+    metrics m   = sc.measure();
+    double  per = data.presses ? 100.0 / double(data.presses) : 0;
+    std::printf("%s\n", lay.name.c_str());
+    std::printf("  presses         %12llu", (unsigned long long)data.presses);
+    if (data.skipped) {
+        std::printf("  (skipped %llu)", (unsigned long long)data.skipped);
+    }
+    std::printf("\n");
+    std::printf("  travel          %12.1f  %6.2f /100\n", m.travel, m.travel * per);
+    std::printf("  same-finger     %12llu  %6.2f /100\n", (unsigned long long)m.sfb, double(m.sfb) * per);
+    std::printf("  layer switches  %12llu  %6.2f /100\n", (unsigned long long)data.layer_switches, double(data.layer_switches) * per);
+    std::printf("  tap-hold        %12llu  %6.2f /100\n", (unsigned long long)m.tap_hold, double(m.tap_hold) * per);
+    std::printf("  score           %12.2f  /100 presses\n", sc.score(m));
+
+    // 指ごとの負担
+    double load[FINGER_COUNT] = {};
+    for (int s = 0; s < data.slots; s++) {
+        load[geom.keys[sc.pos(s)].finger] += double(data.uni[s]);
+    }
+    std::printf("  finger load    ");
+    for (int f = 0; f < FINGER_COUNT; f++) {
+        std::printf(" %s %.1f%%", finger_names[f], load[f] * per);
+    }
+    std::printf("\n");
+}
+
+// 山登り法: 一番良くなる入れ替えを1つずつ採用
+void optimize(const layout &lay, const dataset &data, scorer &sc, int max_swaps, bool swap_thumbs) {
+    int layer_count = int(lay.layers.size());
+    // slot_at[layer][arg]: 今その位置にあるキー
+    std::vector<int> slot_at(data.slots);
+    for (int s = 0; s < data.slots; s++) {
+        slot_at[s] = s;
+    }
+    // 位置 a に今あるキーを動かせるか(透過キーは下のレイヤーの意味が変わるので動かさない)
+    auto movable = [&](int l, int a) {
+        return (swap_thumbs || !geom.is_thumb(a)) && !is_transparent(lay.layers[l][slot_at[l * KEY_COUNT + a] % KEY_COUNT]);
+    };
+
+    std::printf("  proposed swaps:\n");
+    int found = 0;
+    for (; found < max_swaps; found++) {
+        double best = -1e-9;
+        int    bl = -1, ba = -1, bb = -1;
+        for (int l = 0; l < layer_count; l++) {
+            for (int a = 0; a < KEY_COUNT; a++) {
+                if (!movable(l, a)) {
+                    continue;
+                }
+                for (int b = a + 1; b < KEY_COUNT; b++) {
+                    if (!movable(l, b)) {
+                        continue;
+                    }
+                    double d = sc.swap_delta(slot_at[l * KEY_COUNT + a], slot_at[l * KEY_COUNT + b]);
+                    if (d < best) {
+                        best = d;
+                        bl   = l;
+                        ba   = a;
+                        bb   = b;
+                    }
+                }
+            }
+        }
+        if (bl < 0) {
+            break;
+        }
+        int s = slot_at[bl * KEY_COUNT + ba], t = slot_at[bl * KEY_COUNT + bb];
+        sc.apply_swap(s, t);
+        std::swap(slot_at[bl * KEY_COUNT + ba], slot_at[bl * KEY_COUNT + bb]);
+        std::printf("    %2d. L%d %-16s <-> %-16s  %+.3f\n", found + 1, bl, lay.layers[bl][s % KEY_COUNT].c_str(), lay.layers[bl][t % KEY_COUNT].c_str(), best);
+    }
+    if (!found) {
+        std::printf("    (none: no swap lowers the score)\n");
+    } else {
+        std::printf("  score after swaps %.2f /100 presses\n", sc.score(sc.measure()));
+    }
+}
+
+void show_layout(const layout &lay) {
+    std::printf("%s\n", lay.name.c_str());
+    for (size_t l = 0; l < lay.layers.size(); l++) {
+        std::printf("  [%zu]\n", l);
+        for (int r = 0; r < 4; r++) {
+            std::printf("   ");
+            for (int i = r * 10; i < std::min(r * 10 + 10, KEY_COUNT); i++) {
+                std::printf(" %-14.14s", lay.layers[l][i].c_str());
+            }
+            std::printf("\n");
+        }
+    }
+}
+
+void usage() {
+    std::fprintf(stderr,
+                 "usage: layout_cost [--text FILE | --heat FILE...] [--optimize N] [--swap-thumbs]\n"
+                 "                   [--weights T,S,L,H] [--show] FILE[:TABLE]...\n");
+    std::exit(2);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    std::vector<std::string> specs, heats;
+    std::string              text;
+    int                      max_swaps   = 0;
+    bool                     swap_thumbs = false;
+    bool                     show        = false;
+    weights                  w;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg  = argv[i];
+        auto        next = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                usage();
+            }
+            return argv[++i];
+        };
+        if (arg == "--text") {
+            text = next();
+        } else if (arg == "--heat") {
+            heats.push_back(next());
+        } else if (arg == "--optimize") {
+            max_swaps = std::atoi(next().c_str());
+        } else if (arg == "--swap-thumbs") {
+            swap_thumbs = true;
+        } else if (arg == "--show") {
+            show = true;
+        } else if (arg == "--weights") {
+            if (std::sscanf(next().c_str(), "%lf,%lf,%lf,%lf", &w.travel, &w.sfb, &w.layer, &w.tap_hold) != 4) {
+                usage();
+            }
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            usage();
+        } else {
+            specs.push_back(arg);
+        }
+    }
+    if (specs.empty() || (text.empty() && heats.empty() && !show) || (!text.empty() && !heats.empty())) {
+        usage();
+    }
+    if (heats.size() > 1 && heats.size() != specs.size()) {
+        fail("give one --heat per layout, or a single --heat for all");
+    }
+
+    for (size_t i = 0; i < specs.size(); i++) {
+        layout lay = load_layout(specs[i]);
+        if (show) {
+            show_layout(lay);
+        }
+        if (text.empty() && heats.empty()) {
+            continue;
+        }
+        dataset data = text.empty() ? load_heat(heats[heats.size() == 1 ? 0 : i], lay) : load_text(text, lay);
+        scorer  sc(data, lay, w);
+        print_metrics(lay, data, sc);
+        if (max_swaps > 0) {
+            optimize(lay, data, sc, max_swaps, swap_thumbs);
+        }
+        std::printf("\n");
+    }
+    return 0;
+}